@@ -0,0 +1,322 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/aes_decryptor.cc
+ *  @brief AESDecryptor class.
+ */
+
+#include "aes_decryptor.h"
+#include "exceptions.h"
+#include <asdcp/KM_util.h>
+#include <openssl/evp.h>
+#include <boost/foreach.hpp>
+#include <boost/weak_ptr.hpp>
+#include <cstring>
+#include <map>
+
+using std::map;
+using std::pair;
+using std::make_pair;
+using std::string;
+using boost::shared_ptr;
+using boost::weak_ptr;
+using namespace dcp;
+
+/** The plaintext of the check value block which asdcplib puts at the start of each encrypted frame */
+static uint8_t const check_value[ASDCP::CBC_BLOCK_SIZE] = {
+	0x43, 0x48, 0x55, 0x4b, 0x43, 0x48, 0x55, 0x4b,
+	0x43, 0x48, 0x55, 0x4b, 0x43, 0x48, 0x55, 0x4b
+};
+
+/** Size of the integrity pack which follows the encrypted source value when HMAC is in use;
+ *  three 4-byte BER lengths, the asset UUID, a 64-bit sequence number and the HMAC itself.
+ */
+static uint32_t const integrity_pack_size = 3 * 4 + ASDCP::UUIDlen + 8 + ASDCP::HMAC_SIZE;
+
+/** Decryptors that have been handed out by get(), indexed by a digest of the key (so that
+ *  keys are not kept any longer than the decryptors which use them) and standard.
+ */
+static std::map<std::pair<std::string, Standard>, boost::weak_ptr<const AESDecryptor> > decryptors;
+/** mutex to protect decryptors */
+static boost::mutex decryptors_mutex;
+
+AESDecryptor::AESDecryptor (Key key, Standard standard)
+	: _key (key)
+	, _standard (standard)
+	, _cipher (0)
+{
+	if (_key.length() != ASDCP::KeyLen) {
+		throw MiscError ("could not set up crypto context");
+	}
+
+	_cipher = EVP_CIPHER_CTX_new ();
+	if (!_cipher || EVP_DecryptInit_ex (_cipher, EVP_aes_128_cbc(), 0, _key.value(), 0) != 1) {
+		EVP_CIPHER_CTX_free (_cipher);
+		throw MiscError ("could not set up crypto context");
+	}
+
+	EVP_CIPHER_CTX_set_padding (_cipher, 0);
+}
+
+AESDecryptor::~AESDecryptor ()
+{
+	EVP_CIPHER_CTX_free (_cipher);
+	BOOST_FOREACH (ASDCP::HMACContext* i, _hmac_contexts) {
+		delete i;
+	}
+
+	/* Forget about any decryptors which are no longer in use, including this one */
+	boost::mutex::scoped_lock lm (decryptors_mutex);
+	map<pair<string, Standard>, weak_ptr<const AESDecryptor> >::iterator i = decryptors.begin ();
+	while (i != decryptors.end ()) {
+		map<pair<string, Standard>, weak_ptr<const AESDecryptor> >::iterator tmp = i;
+		++i;
+		if (tmp->second.expired ()) {
+			decryptors.erase (tmp);
+		}
+	}
+}
+
+/** @return SHA-256 digest of a key, to index decryptors by */
+static string
+key_digest (Key key)
+{
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int length = 0;
+	if (EVP_Digest (key.value(), key.length(), digest, &length, EVP_sha256(), 0) != 1) {
+		throw MiscError ("could not set up crypto context");
+	}
+	return string (reinterpret_cast<char*> (digest), length);
+}
+
+/** @return A decryptor for a given key and standard; any existing one which is still
+ *  in use will be shared rather than setting up a new one.
+ */
+shared_ptr<const AESDecryptor>
+AESDecryptor::get (Key key, Standard standard)
+{
+	pair<string, Standard> const index = make_pair (key_digest (key), standard);
+
+	{
+		boost::mutex::scoped_lock lm (decryptors_mutex);
+		map<pair<string, Standard>, weak_ptr<const AESDecryptor> >::const_iterator i = decryptors.find (index);
+		if (i != decryptors.end ()) {
+			shared_ptr<const AESDecryptor> d = i->second.lock ();
+			if (d) {
+				return d;
+			}
+		}
+	}
+
+	shared_ptr<const AESDecryptor> d (new AESDecryptor (key, standard));
+
+	boost::mutex::scoped_lock lm (decryptors_mutex);
+	decryptors[index] = d;
+	return d;
+}
+
+/** Find the length of the encrypted source value in a frame read without a decryption context.
+ *  @param buffer Frame.
+ *  @param with_integrity_pack true if the frame should also contain an integrity pack.
+ *  @param length Filled in with the length.
+ *  @return false if the frame is malformed or too small.
+ */
+static bool
+encrypted_source_value_length (ASDCP::FrameBuffer const & buffer, bool with_integrity_pack, uint32_t& length)
+{
+	uint32_t const source_length = buffer.SourceLength ();
+	uint32_t const plaintext_offset = buffer.PlaintextOffset ();
+	if (source_length == 0 || plaintext_offset > source_length) {
+		return false;
+	}
+
+	/* Layout is IV, encrypted check value, plaintext, whole blocks of ciphertext, then
+	   a block containing any leftover ciphertext and padding.
+	*/
+	uint32_t const ciphertext_size = source_length - plaintext_offset;
+	uint32_t const block_size = ciphertext_size - (ciphertext_size % ASDCP::CBC_BLOCK_SIZE);
+	length = plaintext_offset + block_size + ASDCP::CBC_BLOCK_SIZE * 3;
+
+	return buffer.Size() >= length + (with_integrity_pack ? integrity_pack_size : 0);
+}
+
+/** Decrypt a frame in place.
+ *  @param buffer Buffer filled by an asdcplib reader's ReadFrame() with no AESDecContext, so that
+ *  it contains the encrypted source value (and possibly an integrity pack), with SourceLength() and
+ *  PlaintextOffset() set up.  On success it will contain SourceLength() bytes of plaintext.
+ *  @param asset_id UUID of the asset that the frame came from (ASDCP::UUIDlen bytes).
+ *  @param verify_hmac true to check the frame's integrity pack.
+ *  @param sequence Sequence number of the frame in the file: 1 for the first frame.
+ */
+ASDCP::Result_t
+AESDecryptor::decrypt (ASDCP::FrameBuffer& buffer, uint8_t const * asset_id, bool verify_hmac, uint32_t sequence) const
+{
+	uint32_t esv_length;
+	if (!encrypted_source_value_length (buffer, verify_hmac, esv_length)) {
+		return ASDCP::RESULT_FORMAT;
+	}
+
+	uint32_t const source_length = buffer.SourceLength ();
+	uint32_t const plaintext_offset = buffer.PlaintextOffset ();
+	uint32_t const block_size = esv_length - plaintext_offset - ASDCP::CBC_BLOCK_SIZE * 3;
+
+	/* The integrity pack covers the ciphertext, so check it before we overwrite anything */
+	if (verify_hmac) {
+		ASDCP::Result_t const r = check_integrity_pack (buffer, esv_length, asset_id, sequence);
+		if (ASDCP_FAILURE (r)) {
+			return r;
+		}
+	}
+
+	uint8_t* iv = buffer.Data ();
+	uint8_t* encrypted_check_value = iv + ASDCP::CBC_BLOCK_SIZE;
+	uint8_t* plaintext = encrypted_check_value + ASDCP::CBC_BLOCK_SIZE;
+	uint8_t* ciphertext = plaintext + plaintext_offset;
+
+	EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new ();
+	if (!ctx) {
+		return Kumu::RESULT_ALLOC;
+	}
+
+	ASDCP::Result_t result = ASDCP::RESULT_CRYPT_CTX;
+
+	/* Take a copy of the keyed context and set the IV, which keeps the key schedule */
+	if (EVP_CIPHER_CTX_copy (ctx, _cipher) == 1 && EVP_DecryptInit_ex (ctx, 0, 0, 0, iv) == 1) {
+		/* The CBC chain runs from the check value straight into the ciphertext, skipping
+		   the plaintext in between; the EVP context carries it over for us.
+		*/
+		uint8_t check[ASDCP::CBC_BLOCK_SIZE];
+		int out = 0;
+		if (EVP_DecryptUpdate (ctx, check, &out, encrypted_check_value, ASDCP::CBC_BLOCK_SIZE) != 1) {
+			result = ASDCP::RESULT_CRYPT_CTX;
+		} else if (memcmp (check, check_value, ASDCP::CBC_BLOCK_SIZE) != 0) {
+			result = ASDCP::RESULT_CHECKFAIL;
+		} else if (EVP_DecryptUpdate (ctx, ciphertext, &out, ciphertext, block_size + ASDCP::CBC_BLOCK_SIZE) == 1) {
+			/* asdcplib pads the last block with 0, 1, 2 and so on after the leftover
+			   ciphertext, and refuses the frame if the first byte of padding is not 0;
+			   do the same so that both backends accept the same frames.
+			*/
+			uint32_t const leftover = source_length - plaintext_offset - block_size;
+			if (ciphertext[block_size + leftover] != 0) {
+				result = ASDCP::RESULT_FORMAT;
+			} else {
+				/* The plaintext, decrypted blocks and leftover from the last block now run
+				   contiguously from `plaintext'; move them to the start of the buffer.
+				*/
+				memmove (buffer.Data(), plaintext, source_length);
+				buffer.Size (source_length);
+				result = ASDCP::RESULT_OK;
+			}
+		}
+	}
+
+	EVP_CIPHER_CTX_free (ctx);
+	return result;
+}
+
+/** Check the HMAC of a frame, without decrypting it.
+ *  @param buffer Frame as read by asdcplib with no AESDecContext.
+ *  @param asset_id UUID of the asset that the frame came from (ASDCP::UUIDlen bytes).
+ *  @param sequence Sequence number of the frame in the file: 1 for the first frame.
+ */
+ASDCP::Result_t
+AESDecryptor::check_hmac (ASDCP::FrameBuffer const & buffer, uint8_t const * asset_id, uint32_t sequence) const
+{
+	uint32_t esv_length;
+	if (!encrypted_source_value_length (buffer, true, esv_length)) {
+		return ASDCP::RESULT_FORMAT;
+	}
+
+	return check_integrity_pack (buffer, esv_length, asset_id, sequence);
+}
+
+/** Check the integrity pack which follows the encrypted source value in a frame,
+ *  in the same way as asdcplib's IntegrityPack::TestValues.
+ */
+ASDCP::Result_t
+AESDecryptor::check_integrity_pack (ASDCP::FrameBuffer const & buffer, uint32_t esv_length, uint8_t const * asset_id, uint32_t sequence) const
+{
+	/* read_test_BER wants a non-const pointer but does not write through it */
+	uint8_t* p = const_cast<uint8_t*> (buffer.RoData()) + esv_length;
+
+	if (!Kumu::read_test_BER (&p, ASDCP::UUIDlen) || memcmp (p, asset_id, ASDCP::UUIDlen) != 0) {
+		return ASDCP::RESULT_HMACFAIL;
+	}
+	p += ASDCP::UUIDlen;
+
+	if (!Kumu::read_test_BER (&p, 8)) {
+		return ASDCP::RESULT_HMACFAIL;
+	}
+
+	uint64_t test_sequence = 0;
+	for (int i = 0; i < 8; ++i) {
+		test_sequence = (test_sequence << 8) | p[i];
+	}
+	if (test_sequence != sequence) {
+		return ASDCP::RESULT_HMACFAIL;
+	}
+	p += 8;
+
+	if (!Kumu::read_test_BER (&p, ASDCP::HMAC_SIZE)) {
+		return ASDCP::RESULT_HMACFAIL;
+	}
+
+	/* Keying an HMAC context means deriving the MIC key, so re-use contexts where we can */
+	ASDCP::HMACContext* hmac = 0;
+	{
+		boost::mutex::scoped_lock lm (_hmac_mutex);
+		if (!_hmac_contexts.empty ()) {
+			hmac = _hmac_contexts.front ();
+			_hmac_contexts.pop_front ();
+		}
+	}
+
+	if (hmac) {
+		hmac->Reset ();
+	} else {
+		hmac = new ASDCP::HMACContext;
+		if (ASDCP_FAILURE (hmac->InitKey (_key.value(), _standard == INTEROP ? ASDCP::LS_MXF_INTEROP : ASDCP::LS_MXF_SMPTE))) {
+			delete hmac;
+			return ASDCP::RESULT_CRYPT_CTX;
+		}
+	}
+
+	hmac->Update (buffer.RoData(), p - buffer.RoData());
+	hmac->Finalize ();
+	ASDCP::Result_t const r = hmac->TestHMACValue (p);
+
+	boost::mutex::scoped_lock lm (_hmac_mutex);
+	_hmac_contexts.push_back (hmac);
+
+	return r;
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/aes_decryptor.h
+ *  @brief AESDecryptor class.
+ */
+
+#ifndef LIBDCP_AES_DECRYPTOR_H
+#define LIBDCP_AES_DECRYPTOR_H
+
+#include "key.h"
+#include "types.h"
+#include <asdcp/AS_DCP.h>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <stdint.h>
+
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+
+namespace dcp {
+
+/** @class AESDecryptor
+ *  @brief Decryptor for encrypted MXF essence which uses OpenSSL's EVP interface.
+ *
+ *  OpenSSL will use AES-NI (or its equivalent) where the CPU has it, which makes this
+ *  a good deal faster than asdcplib's own AES code.  decrypt() handles the same
+ *  encrypted triplet layout that asdcplib writes, so the results are byte-for-byte
+ *  the same as reading with an ASDCP::AESDecContext.
+ *
+ *  An AESDecryptor holds only things that are fixed for a given key (the AES key schedule
+ *  and some keyed HMAC contexts) so get() hands out one shared instance per key, and
+ *  decrypt() may be called from several threads at once.
+ */
+class AESDecryptor : public boost::noncopyable
+{
+public:
+	~AESDecryptor ();
+
+	static boost::shared_ptr<const AESDecryptor> get (Key key, Standard standard);
+
+	ASDCP::Result_t decrypt (ASDCP::FrameBuffer& buffer, uint8_t const * asset_id, bool verify_hmac, uint32_t sequence) const;
+	ASDCP::Result_t check_hmac (ASDCP::FrameBuffer const & buffer, uint8_t const * asset_id, uint32_t sequence) const;
+
+private:
+	AESDecryptor (Key key, Standard standard);
+
+	ASDCP::Result_t check_integrity_pack (ASDCP::FrameBuffer const & buffer, uint32_t esv_length, uint8_t const * asset_id, uint32_t sequence) const;
+
+	Key _key;
+	Standard _standard;
+	/** EVP context with our key schedule set up; copied for each frame that we decrypt */
+	EVP_CIPHER_CTX* _cipher;
+
+	/** mutex to protect _hmac_contexts */
+	mutable boost::mutex _hmac_mutex;
+	/** HMAC contexts which have been keyed and are not currently in use */
+	mutable std::list<ASDCP::HMACContext*> _hmac_contexts;
+};
+
+}
+
+#endif
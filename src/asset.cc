@@ -131,12 +131,12 @@ Asset::write_file_to_assetmap (xmlpp::Node* node, boost::filesystem::path root,
 }
 
 string
-Asset::hash (function<void (float)> progress) const
+Asset::hash (function<void (float)> progress, ReadCacheMode mode, shared_ptr<RateLimiter> limiter) const
 {
 	DCP_ASSERT (_file);
 
 	if (!_hash) {
-		_hash = make_digest (_file.get(), progress);
+		_hash = make_digest (_file.get(), progress, mode, limiter);
 	}
 
 	return _hash.get();
@@ -45,6 +45,7 @@
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace xmlpp {
 	class Node;
@@ -54,6 +55,8 @@ struct asset_test;
 
 namespace dcp {
 
+class RateLimiter;
+
 /** @class Asset
  *  @brief Parent class for DCP assets, i.e. picture, sound, subtitles, CPLs, fonts.
  *
@@ -88,7 +91,11 @@ public:
 	void set_file (boost::filesystem::path file) const;
 
 	/** @return the hash of this asset's file */
-	std::string hash (boost::function<void (float)> progress = 0) const;
+	std::string hash (
+		boost::function<void (float)> progress = 0,
+		ReadCacheMode mode = READ_CACHE_DEFAULT,
+		boost::shared_ptr<RateLimiter> limiter = boost::shared_ptr<RateLimiter> ()
+		) const;
 
 	void set_hash (std::string hash);
 
@@ -39,9 +39,12 @@
 #include "atmos_asset.h"
 #include "compose.hpp"
 #include "asset_factory.h"
+#include "mxf_cache.h"
 #include <boost/shared_ptr.hpp>
 
+using std::string;
 using boost::shared_ptr;
+using boost::optional;
 using namespace dcp;
 
 shared_ptr<Asset>
@@ -51,6 +54,21 @@ dcp::asset_factory (boost::filesystem::path path, bool ignore_incorrect_picture_
 	   (Interop / SMPTE)
 	*/
 
+	/* If the MXF cache knows what this is we can avoid asdcplib reading the header */
+	shared_ptr<cxml::Document> cache = read_mxf_cache (path, "descriptor");
+	if (cache) {
+		optional<string> cached_type = cache->optional_string_child ("Type");
+		if (cached_type == string ("MonoPicture")) {
+			return shared_ptr<MonoPictureAsset> (new MonoPictureAsset (path));
+		} else if (cached_type == string ("StereoPicture")) {
+			return shared_ptr<StereoPictureAsset> (new StereoPictureAsset (path));
+		} else if (cached_type == string ("Sound")) {
+			return shared_ptr<SoundAsset> (new SoundAsset (path));
+		} else if (cached_type == string ("Atmos")) {
+			return shared_ptr<AtmosAsset> (new AtmosAsset (path));
+		}
+	}
+
 	ASDCP::EssenceType_t type;
 	if (ASDCP::EssenceType (path.string().c_str(), type) != ASDCP::RESULT_OK) {
 		throw DCPReadError ("Could not find essence type");
@@ -37,9 +37,13 @@
 #include "dcp_assert.h"
 #include "asset.h"
 #include "crypto_context.h"
+#include "exceptions.h"
+#include "raw_convert.h"
 #include <asdcp/AS_DCP.h>
+#include <boost/exception_ptr.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
+#include <vector>
 
 namespace dcp {
 
@@ -57,6 +61,11 @@ public:
 			delete _reader;
 			boost::throw_exception (FileError ("could not open MXF file for reading", asset->file().get(), r));
 		}
+
+		ASDCP::WriterInfo info;
+		if (ASDCP_SUCCESS (_reader->FillWriterInfo (info))) {
+			_crypto_context->set_writer_info (info);
+		}
 	}
 
 	~AssetReader ()
@@ -69,6 +78,116 @@ public:
 		return boost::shared_ptr<const F> (new F (_reader, n, _crypto_context));
 	}
 
+	/** Read a frame, re-using the buffer of one previously returned by this reader if
+	 *  nothing else is holding on to it.  This is only available for frame types based on
+	 *  Frame (i.e. sound and Atmos).
+	 *  @param n Frame to read, not taking EntryPoint into account.
+	 *  @param frame A frame previously returned by this reader, or an empty pointer; this
+	 *  will be set to the new frame.
+	 */
+	void get_frame (int n, boost::shared_ptr<const F>& frame) const
+	{
+		if (!frame || !frame.unique ()) {
+			frame = get_frame (n);
+			return;
+		}
+
+		try {
+			boost::const_pointer_cast<F> (frame)->read (_reader, n, _crypto_context, true);
+		} catch (...) {
+			frame.reset ();
+			throw;
+		}
+	}
+
+	/** Read a run of frames.  If the decryption backend decrypts after reading, the frames'
+	 *  ciphertext is read first and then the frames are decrypted in parallel (when libdcp
+	 *  is built with OpenMP).
+	 *  @param first First frame to read, not taking EntryPoint into account.
+	 *  @param count Number of frames to read.
+	 */
+	std::vector<boost::shared_ptr<const F> > get_frames (int first, int count) const
+	{
+		std::vector<boost::shared_ptr<F> > frames;
+		for (int i = 0; i < count; ++i) {
+			frames.push_back (boost::shared_ptr<F> (new F (_reader, first + i, _crypto_context, false)));
+		}
+
+		if (_crypto_context->decrypt_after_read ()) {
+			/* Exceptions must not escape from the parallel loop, so note the first failure
+			   and report it afterwards.
+			*/
+			int failed = -1;
+			/* Any other exception that was thrown while decrypting */
+			boost::exception_ptr error;
+
+#ifdef LIBDCP_OPENMP
+#pragma omp parallel for
+#endif
+			for (int i = 0; i < count; ++i) {
+				try {
+					frames[i]->decrypt (first + i, _crypto_context);
+				} catch (DCPReadError &) {
+#ifdef LIBDCP_OPENMP
+#pragma omp critical
+#endif
+					{
+						if (failed == -1 || i < failed) {
+							failed = i;
+						}
+					}
+				} catch (...) {
+#ifdef LIBDCP_OPENMP
+#pragma omp critical
+#endif
+					{
+						if (!error) {
+							error = boost::current_exception ();
+						}
+					}
+				}
+			}
+
+			if (error) {
+				boost::rethrow_exception (error);
+			}
+
+			if (failed != -1) {
+				boost::throw_exception (DCPReadError ("could not decrypt frame " + raw_convert<std::string> (first + failed)));
+			}
+		}
+
+		return std::vector<boost::shared_ptr<const F> > (frames.begin(), frames.end());
+	}
+
+	/** Set the implementation that will be used to decrypt frames; this has no
+	 *  effect if the asset is not encrypted or no key was given.
+	 */
+	void set_decryption_backend (DecryptionBackend backend)
+	{
+		_crypto_context->set_backend (backend);
+	}
+
+	/** Check HMACs on a separate thread after frames have been decrypted and returned,
+	 *  rather than before; this also selects the DECRYPTION_OPENSSL backend.  Every frame
+	 *  is still checked, including any that are waiting when this reader is destroyed.
+	 *  @param mismatch Handler to be called, from the checking thread, with the index of
+	 *  any frame whose HMAC is wrong.  If it throws an exception, no more frames are checked
+	 *  and the exception is thrown from the next read or flush_hmac_checks().
+	 */
+	void set_deferred_hmac_check (boost::function<void (int)> mismatch)
+	{
+		_crypto_context->set_deferred_hmac_check (mismatch);
+	}
+
+	/** Wait until all deferred HMAC checks on frames read so far have been done, throwing
+	 *  any exception from the mismatch handler.
+	 */
+	void flush_hmac_checks ()
+	{
+		_crypto_context->flush_hmac_checks ();
+	}
+
 protected:
 	R* _reader;
 	boost::shared_ptr<DecryptionContext> _crypto_context;
@@ -39,9 +39,17 @@
 #include "mxf.h"
 #include "dcp_assert.h"
 #include "crypto_context.h"
+#include "writer_thread.h"
+#include "util.h"
 #include <asdcp/AS_DCP.h>
 #include <asdcp/KM_prng.h>
+#include <algorithm>
+#ifdef LIBDCP_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
+using boost::function;
 using namespace dcp;
 
 /** Create an AssetWriter.
@@ -55,15 +63,157 @@ AssetWriter::AssetWriter (MXF* mxf, boost::filesystem::path file)
 	, _finalized (false)
 	, _started (false)
 	, _crypto_context (new EncryptionContext (mxf->key(), mxf->standard()))
+	, _expected_size (0)
+	, _hash_on_finalize (false)
 {
 
 }
 
+AssetWriter::~AssetWriter ()
+{
+	/* Subclasses should already have done this, since queued jobs may use their state */
+	stop_asynchronous ();
+}
+
+/** Write frames on a background thread from now on.  Must be called before anything is written.
+ *  @param max_queue_length Maximum number of frames that can be waiting to be written; after that,
+ *  calls to write will block until the writer thread catches up.
+ */
+void
+AssetWriter::set_asynchronous (int max_queue_length)
+{
+	DCP_ASSERT (!_started);
+	DCP_ASSERT (!_writer_thread);
+	_writer_thread.reset (new WriterThread (max_queue_length));
+}
+
+/** Run a job on the writer thread if we have one, otherwise run it now */
+void
+AssetWriter::queue (function<void ()> job)
+{
+	if (_writer_thread) {
+		_writer_thread->add (job);
+	} else {
+		job ();
+	}
+}
+
+/** Wait for all queued frames to be written */
+void
+AssetWriter::drain ()
+{
+	if (_writer_thread) {
+		_writer_thread->drain ();
+	}
+}
+
+/** Finish any queued writes and stop the writer thread, without reporting errors */
+void
+AssetWriter::stop_asynchronous ()
+{
+	_writer_thread.reset ();
+}
+
+/** @return A copy of the statistics for what has been written so far; this can be called
+ *  from any thread while writing is going on.
+ */
+WriterStats
+AssetWriter::stats () const
+{
+	boost::mutex::scoped_lock lm (_stats_mutex);
+	return _stats;
+}
+
+/** Called by subclasses after writing each frame.
+ *  @param bytes Number of bytes written to the file.
+ *  @param parse_time Time spent parsing the frame, in microseconds.
+ *  @param write_time Time spent in asdcplib writing the frame, in microseconds.
+ */
+void
+AssetWriter::add_stats (int64_t bytes, int64_t parse_time, int64_t write_time)
+{
+	int64_t const latency = std::max (parse_time + write_time, int64_t (0));
+	int bucket = 0;
+	while (bucket < (WriterStats::histogram_buckets - 1) && (latency >> (bucket + 1)) > 0) {
+		++bucket;
+	}
+
+	boost::mutex::scoped_lock lm (_stats_mutex);
+	++_stats.frames;
+	_stats.bytes += bytes;
+	_stats.parse_time += parse_time;
+	_stats.write_time += write_time;
+	++_stats.latency_histogram[bucket];
+}
+
+/** Note that a frame has been written; this may be called from our writer thread */
+void
+AssetWriter::frame_written ()
+{
+	boost::mutex::scoped_lock lm (_stats_mutex);
+	++_frames_written;
+}
+
+/** Allocate disk space for the whole of our file, if we know how big it will be.  This
+ *  should be called by subclasses just after the file has been opened.  The file's size
+ *  is not changed, so nothing needs to be done if the file ends up a different size
+ *  to what was expected.
+ */
+void
+AssetWriter::preallocate ()
+{
+#if defined(LIBDCP_POSIX) && defined(FALLOC_FL_KEEP_SIZE)
+	if (_expected_size == 0) {
+		return;
+	}
+
+	int const fd = open (_file.string().c_str(), O_WRONLY);
+	if (fd == -1) {
+		return;
+	}
+
+	/* This is only a hint, so ignore errors (e.g. from filesystems which don't support it) */
+	fallocate (fd, FALLOC_FL_KEEP_SIZE, 0, _expected_size);
+	close (fd);
+#endif
+}
+
+/** Release any space that preallocate() reserved past the end of the finished file */
+static void
+trim_preallocation (boost::filesystem::path file, uint64_t expected_size)
+{
+#if defined(LIBDCP_POSIX) && defined(FALLOC_FL_KEEP_SIZE)
+	boost::system::error_code ec;
+	uint64_t const size = boost::filesystem::file_size (file, ec);
+	if (ec || size >= expected_size) {
+		return;
+	}
+
+	int const fd = open (file.string().c_str(), O_WRONLY);
+	if (fd == -1) {
+		return;
+	}
+
+	/* Punching holes at or past the end of the file does nothing on some filesystems (e.g. ext4),
+	   but truncating to the current size frees any blocks beyond it.
+	*/
+	if (ftruncate (fd, size) == -1) {
+		/* Again, nothing here is essential, so ignore errors */
+	}
+	close (fd);
+#endif
+}
+
 /** @return true if anything was written by this writer */
 bool
 AssetWriter::finalize ()
 {
 	DCP_ASSERT (!_finalized);
+	stop_asynchronous ();
+
+	if (_started && _expected_size > 0) {
+		trim_preallocation (_file, _expected_size);
+	}
 	_finalized = true;
 	return _started;
 }
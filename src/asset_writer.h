@@ -40,38 +40,81 @@
 
 #include "types.h"
 #include "crypto_context.h"
+#include "writer_stats.h"
 #include <boost/filesystem.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace dcp {
 
 class MXF;
+class WriterThread;
 
 /** @class AssetWriter
  *  @brief Parent class for classes which can write MXF-based assets.
  *
  *  The AssetWriter lasts for the duration of the write and is then discarded.
  *  They can only be created by calling start_write() on an appropriate Asset object.
+ *
+ *  After set_asynchronous() has been called, frames are copied into a queue and
+ *  written to disk by a background thread.  Errors from that thread are thrown by
+ *  a later write or by finalize(), which waits for the queue to empty; once there
+ *  has been an error every later write and finalize() will throw it, since the
+ *  file is missing frames.
  */
 class AssetWriter : public boost::noncopyable
 {
 public:
-	virtual ~AssetWriter () {}
+	virtual ~AssetWriter ();
 	virtual bool finalize ();
 
+	void set_asynchronous (int max_queue_length = 16);
+
+	/** Set the size that the finished file is expected to be (for example the number of
+	 *  frames multiplied by the bit rate, divided by 8 and by the frame rate), so that the
+	 *  space can be allocated in one piece when writing starts.  This reduces fragmentation
+	 *  of the file on filesystems which support it.  Must be called before anything is written.
+	 */
+	void set_expected_size (uint64_t bytes) {
+		_expected_size = bytes;
+	}
+
+	/** Find the hash of the file in finalize() and give it to the asset, so that it need not
+	 *  be found later (for example when a PKL is written).  asdcplib rewrites the start of the
+	 *  file when finalising, so the hash can't be found while writing; this reads the finished
+	 *  file once more, while much of it is probably still in the page cache.  It is off by default.
+	 */
+	void set_hash_on_finalize (bool hash) {
+		_hash_on_finalize = hash;
+	}
+
 	int64_t frames_written () const {
+		boost::mutex::scoped_lock lm (_stats_mutex);
 		return _frames_written;
 	}
 
+	WriterStats stats () const;
+
 protected:
 	AssetWriter (MXF* mxf, boost::filesystem::path file);
 
+	void queue (boost::function<void ()> job);
+	void drain ();
+	void stop_asynchronous ();
+	void preallocate ();
+
+	void add_stats (int64_t bytes, int64_t parse_time, int64_t write_time);
+	void frame_written ();
+
 	/** MXF that we are writing */
 	MXF* _mxf;
 	/** File that we are writing to */
 	boost::filesystem::path _file;
 	/** Number of `frames' written so far; the definition of a frame
-	 *  varies depending on the subclass.
+	 *  varies depending on the subclass.  This may be changed by our writer
+	 *  thread, so it must be changed with frame_written() and read with
+	 *  frames_written().
 	 */
 	int64_t _frames_written;
 	/** true if finalize() has been called on this object */
@@ -79,6 +122,15 @@ protected:
 	/** true if something has been written to this asset */
 	bool _started;
 	boost::shared_ptr<EncryptionContext> _crypto_context;
+	/** size in bytes that we expect our file to end up, or 0 if we don't know */
+	uint64_t _expected_size;
+	/** true to find the hash of our file in finalize() */
+	bool _hash_on_finalize;
+	/** mutex to protect _frames_written and _stats, which may be read while another thread is writing */
+	mutable boost::mutex _stats_mutex;
+	WriterStats _stats;
+	/** thread to do our writing, or 0 if we are writing synchronously */
+	boost::shared_ptr<WriterThread> _writer_thread;
 };
 
 }
@@ -35,9 +35,13 @@
 #include "atmos_asset_reader.h"
 #include "atmos_asset_writer.h"
 #include "exceptions.h"
+#include "dcp_assert.h"
+#include "raw_convert.h"
+#include <libxml++/libxml++.h>
 #include <asdcp/AS_DCP.h>
 
 using std::string;
+using std::vector;
 using boost::shared_ptr;
 using namespace dcp;
 
@@ -58,6 +62,10 @@ AtmosAsset::AtmosAsset (boost::filesystem::path file)
 	: Asset (file)
 	, MXF (SMPTE)
 {
+	if (read_cache (file, "Atmos")) {
+		return;
+	}
+
 	ASDCP::ATMOS::MXFReader reader;
 	Kumu::Result_t r = reader.OpenRead (file.string().c_str());
 	if (ASDCP_FAILURE (r)) {
@@ -80,6 +88,8 @@ AtmosAsset::AtmosAsset (boost::filesystem::path file)
 	_atmos_id = id;
 
 	_atmos_version = desc.AtmosVersion;
+
+	write_cache (file, "Atmos", _id);
 }
 
 string
@@ -94,6 +104,38 @@ AtmosAsset::start_read () const
 	return shared_ptr<AtmosAssetReader> (new AtmosAssetReader (this, key(), SMPTE));
 }
 
+vector<FrameIndexEntry>
+AtmosAsset::frame_index () const
+{
+	DCP_ASSERT (_file);
+
+	return cached_frame_index<ASDCP::ATMOS::MXFReader> (_file.get(), _intrinsic_duration);
+}
+
+void
+AtmosAsset::read_cache_descriptor (cxml::ConstNodePtr node)
+{
+	_edit_rate = Fraction (node->string_child ("EditRate"));
+	_intrinsic_duration = node->number_child<int64_t> ("IntrinsicDuration");
+	_first_frame = node->number_child<int> ("FirstFrame");
+	_max_channel_count = node->number_child<int> ("MaxChannelCount");
+	_max_object_count = node->number_child<int> ("MaxObjectCount");
+	_atmos_id = node->string_child ("AtmosId");
+	_atmos_version = node->number_child<int> ("AtmosVersion");
+}
+
+void
+AtmosAsset::write_cache_descriptor (xmlpp::Element* node) const
+{
+	node->add_child("EditRate")->add_child_text (_edit_rate.as_string ());
+	node->add_child("IntrinsicDuration")->add_child_text (raw_convert<string> (_intrinsic_duration));
+	node->add_child("FirstFrame")->add_child_text (raw_convert<string> (_first_frame));
+	node->add_child("MaxChannelCount")->add_child_text (raw_convert<string> (_max_channel_count));
+	node->add_child("MaxObjectCount")->add_child_text (raw_convert<string> (_max_object_count));
+	node->add_child("AtmosId")->add_child_text (_atmos_id);
+	node->add_child("AtmosVersion")->add_child_text (raw_convert<string> (_atmos_version));
+}
+
 shared_ptr<AtmosAssetWriter>
 AtmosAsset::start_write (boost::filesystem::path file)
 {
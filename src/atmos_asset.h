@@ -51,6 +51,9 @@ public:
 	boost::shared_ptr<AtmosAssetWriter> start_write (boost::filesystem::path file);
 	boost::shared_ptr<AtmosAssetReader> start_read () const;
 
+	/** @return the position and size of each frame's essence in our file, read from the MXF index table */
+	std::vector<FrameIndexEntry> frame_index () const;
+
 	static std::string static_pkl_type (Standard);
 	std::string pkl_type (Standard s) const {
 		return static_pkl_type (s);
@@ -90,6 +93,9 @@ public:
 private:
 	friend class AtmosAssetWriter;
 
+	void read_cache_descriptor (cxml::ConstNodePtr node);
+	void write_cache_descriptor (xmlpp::Element* node) const;
+
 	Fraction _edit_rate;
 	int64_t _intrinsic_duration;
 	int _first_frame;
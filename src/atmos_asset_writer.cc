@@ -37,7 +37,9 @@
 #include "dcp_assert.h"
 #include "compose.hpp"
 #include "crypto_context.h"
+#include "util.h"
 #include <asdcp/AS_DCP.h>
+#include <boost/bind.hpp>
 
 using std::min;
 using std::max;
@@ -70,40 +72,81 @@ AtmosAssetWriter::AtmosAssetWriter (AtmosAsset* asset, boost::filesystem::path f
 	_asset->fill_writer_info (&_state->writer_info, _asset->id());
 }
 
+AtmosAssetWriter::~AtmosAssetWriter ()
+{
+	/* Queued writes use _state, so they must finish before it goes away */
+	stop_asynchronous ();
+}
+
 void
 AtmosAssetWriter::write (uint8_t const * data, int size)
 {
 	DCP_ASSERT (!_finalized);
 
+	if (_writer_thread) {
+		write (Data (data, size));
+	} else {
+		write_frame (data, size);
+	}
+}
+
+/** Write a frame.  If the writer is asynchronous the frame is queued without being
+ *  copied, so its data must not be modified after this call.
+ */
+void
+AtmosAssetWriter::write (Data data)
+{
+	DCP_ASSERT (!_finalized);
+	queue (boost::bind (&AtmosAssetWriter::write_queued, this, data));
+}
+
+void
+AtmosAssetWriter::write_queued (Data data)
+{
+	write_frame (data.data().get(), data.size());
+}
+
+void
+AtmosAssetWriter::write_frame (uint8_t const * data, int size)
+{
 	if (!_started) {
 		Kumu::Result_t r = _state->mxf_writer.OpenWrite (_file.string().c_str(), _state->writer_info, _state->desc);
 		if (ASDCP_FAILURE (r)) {
 			boost::throw_exception (FileError ("could not open atmos MXF for writing", _file.string(), r));
 		}
 
+		preallocate ();
 		_asset->set_file (_file);
 		_started = true;
 	}
 
-	_state->frame_buffer.Capacity (size);
+	/* WriteFrame only reads from the buffer, even when encrypting, so we can point it at the caller's data */
+	_state->frame_buffer.SetData (const_cast<uint8_t*> (data), size);
 	_state->frame_buffer.Size (size);
-	memcpy (_state->frame_buffer.Data(), data, size);
 
+	int64_t const start = monotonic_microseconds ();
 	ASDCP::Result_t const r = _state->mxf_writer.WriteFrame (_state->frame_buffer, _crypto_context->context(), _crypto_context->hmac());
 	if (ASDCP_FAILURE (r)) {
 		boost::throw_exception (MiscError (String::compose ("could not write atmos MXF frame (%1)", int (r))));
 	}
+	add_stats (size, 0, monotonic_microseconds () - start);
 
-	++_frames_written;
+	frame_written ();
 }
 
 bool
 AtmosAssetWriter::finalize ()
 {
+	drain ();
+
 	if (_started && ASDCP_FAILURE (_state->mxf_writer.Finalize())) {
 		boost::throw_exception (MiscError ("could not finalise atmos MXF"));
 	}
 
-	_asset->_intrinsic_duration = _frames_written;
+	if (_started && _hash_on_finalize) {
+		_asset->set_hash (make_digest (_file, 0));
+	}
+
+	_asset->_intrinsic_duration = frames_written ();
 	return AssetWriter::finalize ();
 }
@@ -38,6 +38,7 @@
 #include "asset_writer.h"
 #include "types.h"
 #include "atmos_frame.h"
+#include "data.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/filesystem.hpp>
 
@@ -49,11 +50,17 @@ class AtmosAsset;
  *  @brief A helper class for writing to AtmosAssets.
  *
  *  Objects of this class can only be created with AtmosAsset::start_write().
+ *
+ *  Frames are written straight from the caller's data without being copied, unless the
+ *  writer is asynchronous, in which case write (Data) avoids a copy.
  */
 class AtmosAssetWriter : public AssetWriter
 {
 public:
+	~AtmosAssetWriter ();
+
 	void write (uint8_t const * data, int size);
+	void write (Data data);
 	bool finalize ();
 
 private:
@@ -61,6 +68,9 @@ private:
 
 	AtmosAssetWriter (AtmosAsset *, boost::filesystem::path);
 
+	void write_frame (uint8_t const * data, int size);
+	void write_queued (Data data);
+
 	/* do this with an opaque pointer so we don't have to include
 	   ASDCP headers
 	*/
@@ -0,0 +1,167 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/crypto_context.cc
+ *  @brief DecryptionContext class.
+ */
+
+#include "crypto_context.h"
+#include "dcp_assert.h"
+#include <cstring>
+
+using boost::optional;
+using namespace dcp;
+
+DecryptionContext::DecryptionContext (optional<Key> key, Standard standard)
+	: _key (key)
+	, _standard (standard)
+	, _backend (DECRYPTION_ASDCPLIB)
+	, _context (0)
+	, _hmac (0)
+	, _encrypted (false)
+	, _uses_hmac (false)
+{
+	memset (_asset_id, 0, sizeof (_asset_id));
+}
+
+DecryptionContext::~DecryptionContext ()
+{
+	delete _context;
+	delete _hmac;
+}
+
+/** Set up the asdcplib contexts, if we have a key and they are not set up already */
+void
+DecryptionContext::setup_asdcplib () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	if (!_key || _context) {
+		return;
+	}
+
+	ASDCP::AESDecContext* context = new ASDCP::AESDecContext;
+	if (ASDCP_FAILURE (context->InitKey (_key->value ()))) {
+		delete context;
+		throw MiscError ("could not set up crypto context");
+	}
+
+	ASDCP::HMACContext* hmac = new ASDCP::HMACContext;
+	if (ASDCP_FAILURE (hmac->InitKey (_key->value(), _standard == INTEROP ? ASDCP::LS_MXF_INTEROP : ASDCP::LS_MXF_SMPTE))) {
+		delete context;
+		delete hmac;
+		throw MiscError ("could not set up HMAC context");
+	}
+
+	_context = context;
+	_hmac = hmac;
+}
+
+/** @return asdcplib decryption context to pass to a reader, or 0 if we have no key */
+ASDCP::AESDecContext*
+DecryptionContext::context () const
+{
+	setup_asdcplib ();
+	return _context;
+}
+
+/** @return asdcplib HMAC context to pass to a reader, or 0 if we have no key */
+ASDCP::HMACContext*
+DecryptionContext::hmac () const
+{
+	setup_asdcplib ();
+	return _hmac;
+}
+
+void
+DecryptionContext::set_backend (DecryptionBackend backend)
+{
+	_backend = backend;
+	if (_backend == DECRYPTION_OPENSSL && _key && !_decryptor) {
+		_decryptor = AESDecryptor::get (*_key, _standard);
+	}
+}
+
+/** Tell this context about the MXF that it will be used with.
+ *  @param info Information from the reader's FillWriterInfo().
+ */
+void
+DecryptionContext::set_writer_info (ASDCP::WriterInfo const & info)
+{
+	_encrypted = info.EncryptedEssence;
+	_uses_hmac = info.UsesHMAC;
+	memcpy (_asset_id, info.AssetUUID, sizeof (_asset_id));
+}
+
+/** Check HMACs on a separate thread after frames have been decrypted, rather than
+ *  before.  Checking needs the frames' ciphertext, so this also selects the
+ *  DECRYPTION_OPENSSL backend.
+ *  @param mismatch Handler which will be called, from the checking thread, with the
+ *  index of any frame whose HMAC is wrong.
+ */
+void
+DecryptionContext::set_deferred_hmac_check (boost::function<void (int)> mismatch)
+{
+	set_backend (DECRYPTION_OPENSSL);
+	if (_decryptor) {
+		_hmac_checker.reset (new HMACChecker (_decryptor, mismatch));
+	}
+}
+
+/** Wait until any HMAC checks that have been deferred have been done */
+void
+DecryptionContext::flush_hmac_checks ()
+{
+	if (_hmac_checker) {
+		_hmac_checker->flush ();
+	}
+}
+
+/** Decrypt a frame in place, checking its HMAC (or arranging for it to be checked
+ *  later) if the MXF has them.  This may be called from several threads at once.
+ *  @param buffer Frame as read with no context.
+ *  @param frame Index of the frame in the asset.
+ *  @param sequence Sequence number of the frame in the MXF, starting from 1.
+ */
+ASDCP::Result_t
+DecryptionContext::decrypt (ASDCP::FrameBuffer& buffer, int frame, uint32_t sequence) const
+{
+	DCP_ASSERT (_decryptor);
+
+	if (_uses_hmac && _hmac_checker) {
+		_hmac_checker->add (buffer, _asset_id, frame, sequence);
+		return _decryptor->decrypt (buffer, _asset_id, false, sequence);
+	}
+
+	return _decryptor->decrypt (buffer, _asset_id, _uses_hmac, sequence);
+}
@@ -37,17 +37,25 @@
 #include "key.h"
 #include "types.h"
 #include "exceptions.h"
+#include "aes_decryptor.h"
+#include "hmac_checker.h"
 #include <asdcp/AS_DCP.h>
 #include <asdcp/KM_prng.h>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace dcp {
 
-template <class T>
-class CryptoContext
+/** @class EncryptionContext
+ *  @brief Context for encrypting frames as they are written to an MXF.
+ */
+class EncryptionContext : public boost::noncopyable
 {
 public:
-	CryptoContext (boost::optional<Key> key, Standard standard)
+	EncryptionContext (boost::optional<Key> key, Standard standard)
 		: _context (0)
 		, _hmac (0)
 	{
@@ -55,7 +63,7 @@ public:
 			return;
 		}
 
-		_context = new T;
+		_context = new ASDCP::AESEncContext;
 		if (ASDCP_FAILURE (_context->InitKey (key->value ()))) {
 			throw MiscError ("could not set up crypto context");
 		}
@@ -81,13 +89,13 @@ public:
 		}
 	}
 
-	~CryptoContext ()
+	~EncryptionContext ()
 	{
 		delete _context;
 		delete _hmac;
 	}
 
-	T* context () const {
+	ASDCP::AESEncContext* context () const {
 		return _context;
 	}
 
@@ -96,12 +104,75 @@ public:
 	}
 
 private:
-	T* _context;
+	ASDCP::AESEncContext* _context;
 	ASDCP::HMACContext* _hmac;
 };
 
-typedef CryptoContext<ASDCP::AESEncContext> EncryptionContext;
-typedef CryptoContext<ASDCP::AESDecContext> DecryptionContext;
+/** @class DecryptionContext
+ *  @brief Context for decrypting frames as they are read from an MXF.
+ *
+ *  By default frames are decrypted by asdcplib as it reads them, using context() and hmac().
+ *  With the DECRYPTION_OPENSSL backend the reader is instead asked for the frame's ciphertext,
+ *  which is then decrypted in place by decrypt().
+ *
+ *  The OpenSSL backend can also check HMACs in the background (see set_deferred_hmac_check()),
+ *  so that frames are handed out as soon as they are decrypted.
+ *
+ *  Unlike an EncryptionContext this needs no random IV (each frame carries its own), so
+ *  construction is cheap: asdcplib's contexts are only set up when first asked for, and
+ *  the OpenSSL backend shares one AESDecryptor between all contexts with the same key.
+ */
+class DecryptionContext : public boost::noncopyable
+{
+public:
+	DecryptionContext (boost::optional<Key> key, Standard standard);
+	~DecryptionContext ();
+
+	ASDCP::AESDecContext* context () const;
+	ASDCP::HMACContext* hmac () const;
+
+	void set_backend (DecryptionBackend backend);
+
+	DecryptionBackend backend () const {
+		return _backend;
+	}
+
+	void set_writer_info (ASDCP::WriterInfo const & info);
+
+	/** @return true if frames should be read without a context (so that the reader
+	 *  gives back ciphertext) and then passed to decrypt().
+	 */
+	bool decrypt_after_read () const {
+		return _backend == DECRYPTION_OPENSSL && _decryptor && _encrypted;
+	}
+
+	void set_deferred_hmac_check (boost::function<void (int)> mismatch);
+	void flush_hmac_checks ();
+
+	ASDCP::Result_t decrypt (ASDCP::FrameBuffer& buffer, int frame, uint32_t sequence) const;
+
+private:
+	void setup_asdcplib () const;
+
+	boost::optional<Key> _key;
+	Standard _standard;
+	DecryptionBackend _backend;
+
+	/** mutex to protect the lazy setup of _context and _hmac */
+	mutable boost::mutex _mutex;
+	mutable ASDCP::AESDecContext* _context;
+	mutable ASDCP::HMACContext* _hmac;
+
+	boost::shared_ptr<const AESDecryptor> _decryptor;
+	/** checker for HMACs, if they are being checked after decryption rather than before */
+	boost::shared_ptr<HMACChecker> _hmac_checker;
+	/** true if the MXF's essence is encrypted */
+	bool _encrypted;
+	/** true if the MXF's frames have integrity packs */
+	bool _uses_hmac;
+	/** UUID of the MXF's asset, used to check integrity packs */
+	uint8_t _asset_id[ASDCP::UUIDlen];
+};
 
 }
 
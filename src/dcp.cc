@@ -58,6 +58,7 @@
 #include "font_asset.h"
 #include "pkl.h"
 #include "asset_factory.h"
+#include "hash_assets.h"
 #include <asdcp/AS_DCP.h>
 #include <xmlsec/xmldsig.h>
 #include <xmlsec/app.h>
@@ -75,6 +76,7 @@ using std::map;
 using std::cerr;
 using std::exception;
 using boost::shared_ptr;
+using boost::function;
 using boost::dynamic_pointer_cast;
 using boost::optional;
 using boost::algorithm::starts_with;
@@ -424,13 +426,19 @@ DCP::write_assetmap (Standard standard, string pkl_uuid, boost::filesystem::path
  *  @param standand INTEROP or SMPTE.
  *  @param metadata Metadata to use for PKL and asset map files.
  *  @param signer Signer to use, or 0.
+ *  @param name_format Format for the names of the CPL and PKL files.
+ *  @param progress Function to call with progress (from 0 to 1) through hashing the assets for the PKL.
+ *  This may be called from any thread, but never from two at once.
+ *  @param hash_threads Number of assets to hash at the same time.
  */
 void
 DCP::write_xml (
 	Standard standard,
 	XMLMetadata metadata,
 	shared_ptr<const CertificateChain> signer,
-	NameFormat name_format
+	NameFormat name_format,
+	function<void (float)> progress,
+	int hash_threads
 	)
 {
 	BOOST_FOREACH (shared_ptr<CPL> i, cpls ()) {
@@ -444,6 +452,7 @@ DCP::write_xml (
 	if (_pkls.empty()) {
 		pkl.reset (new PKL (standard, metadata.annotation_text, metadata.issue_date, metadata.issuer, metadata.creator));
 		_pkls.push_back (pkl);
+		hash_assets (assets (), hash_threads, progress);
 		BOOST_FOREACH (shared_ptr<Asset> i, assets ()) {
 			i->add_to_pkl (pkl, _directory);
 		}
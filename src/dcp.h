@@ -45,6 +45,7 @@
 #include "name_format.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/signals2.hpp>
+#include <boost/function.hpp>
 #include <string>
 #include <vector>
 
@@ -115,7 +116,9 @@ public:
 		Standard standard,
 		XMLMetadata metadata = XMLMetadata (),
 		boost::shared_ptr<const CertificateChain> signer = boost::shared_ptr<const CertificateChain> (),
-		NameFormat name_format = NameFormat("%t")
+		NameFormat name_format = NameFormat("%t"),
+		boost::function<void (float)> progress = boost::function<void (float)> (),
+		int hash_threads = 1
 	);
 
 	void resolve_refs (std::list<boost::shared_ptr<Asset> > assets);
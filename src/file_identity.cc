@@ -0,0 +1,140 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/file_identity.cc
+ *  @brief FileIdentity class.
+ */
+
+#include "file_identity.h"
+#include "exceptions.h"
+#include "raw_convert.h"
+#include <libxml++/libxml++.h>
+#ifdef LIBDCP_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+#include <errno.h>
+
+using std::string;
+using namespace dcp;
+
+FileIdentity::FileIdentity ()
+	: _size (0)
+	, _modification_time (0)
+	, _modification_time_nsec (0)
+	, _change_time (0)
+	, _change_time_nsec (0)
+	, _device (0)
+	, _inode (0)
+{
+
+}
+
+/** Find the identity of a file on disk.
+ *  @param file File, which must exist.
+ */
+FileIdentity::FileIdentity (boost::filesystem::path file)
+	: _path (boost::filesystem::canonical (file))
+{
+#ifdef LIBDCP_POSIX
+	struct stat st;
+	if (stat (_path.string().c_str(), &st) == -1) {
+		boost::throw_exception (FileError ("could not find details of file", file, errno));
+	}
+	_size = st.st_size;
+	_modification_time = st.st_mtime;
+	_change_time = st.st_ctime;
+#ifdef __APPLE__
+	_modification_time_nsec = st.st_mtimespec.tv_nsec;
+	_change_time_nsec = st.st_ctimespec.tv_nsec;
+#else
+	_modification_time_nsec = st.st_mtim.tv_nsec;
+	_change_time_nsec = st.st_ctim.tv_nsec;
+#endif
+	_device = st.st_dev;
+	_inode = st.st_ino;
+#else
+	_size = boost::filesystem::file_size (_path);
+	_modification_time = boost::filesystem::last_write_time (_path);
+	_modification_time_nsec = 0;
+	_change_time = 0;
+	_change_time_nsec = 0;
+	_device = 0;
+	_inode = 0;
+#endif
+}
+
+FileIdentity::FileIdentity (cxml::ConstNodePtr node)
+	: _path (node->string_child ("Path"))
+	, _size (node->number_child<uintmax_t> ("Size"))
+	, _modification_time (node->number_child<int64_t> ("ModificationTime"))
+	, _modification_time_nsec (node->number_child<int64_t> ("ModificationTimeNsec"))
+	, _change_time (node->number_child<int64_t> ("ChangeTime"))
+	, _change_time_nsec (node->number_child<int64_t> ("ChangeTimeNsec"))
+	, _device (node->number_child<uint64_t> ("Device"))
+	, _inode (node->number_child<uint64_t> ("Inode"))
+{
+
+}
+
+void
+FileIdentity::as_xml (xmlpp::Element* node) const
+{
+	node->add_child("Path")->add_child_text (_path.string ());
+	node->add_child("Size")->add_child_text (raw_convert<string> (_size));
+	node->add_child("ModificationTime")->add_child_text (raw_convert<string> (static_cast<int64_t> (_modification_time)));
+	node->add_child("ModificationTimeNsec")->add_child_text (raw_convert<string> (_modification_time_nsec));
+	node->add_child("ChangeTime")->add_child_text (raw_convert<string> (static_cast<int64_t> (_change_time)));
+	node->add_child("ChangeTimeNsec")->add_child_text (raw_convert<string> (_change_time_nsec));
+	node->add_child("Device")->add_child_text (raw_convert<string> (_device));
+	node->add_child("Inode")->add_child_text (raw_convert<string> (_inode));
+}
+
+bool
+dcp::operator== (FileIdentity const & a, FileIdentity const & b)
+{
+	return a.path() == b.path() &&
+		a.size() == b.size() &&
+		a.modification_time() == b.modification_time() &&
+		a.modification_time_nsec() == b.modification_time_nsec() &&
+		a.change_time() == b.change_time() &&
+		a.change_time_nsec() == b.change_time_nsec() &&
+		a.device() == b.device() &&
+		a.inode() == b.inode();
+}
+
+bool
+dcp::operator!= (FileIdentity const & a, FileIdentity const & b)
+{
+	return !(a == b);
+}
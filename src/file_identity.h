@@ -0,0 +1,122 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/file_identity.h
+ *  @brief FileIdentity class.
+ */
+
+#ifndef LIBDCP_FILE_IDENTITY_H
+#define LIBDCP_FILE_IDENTITY_H
+
+#include <libcxml/cxml.h>
+#include <boost/filesystem.hpp>
+#include <stdint.h>
+#include <time.h>
+
+namespace xmlpp {
+	class Element;
+}
+
+namespace dcp {
+
+/** @class FileIdentity
+ *  @brief Details of a file on disk which will change if the file is modified or replaced.
+ *
+ *  Where the system gives them, the modification and status change times are kept to the
+ *  nanosecond, so that a file which is rewritten in place without changing its size is
+ *  still seen to have changed.
+ */
+class FileIdentity
+{
+public:
+	FileIdentity ();
+	explicit FileIdentity (boost::filesystem::path file);
+	explicit FileIdentity (cxml::ConstNodePtr node);
+
+	void as_xml (xmlpp::Element* node) const;
+
+	/** @return canonical path of the file */
+	boost::filesystem::path path () const {
+		return _path;
+	}
+
+	uintmax_t size () const {
+		return _size;
+	}
+
+	time_t modification_time () const {
+		return _modification_time;
+	}
+
+	/** @return nanoseconds part of the modification time, or 0 if it is not known */
+	int64_t modification_time_nsec () const {
+		return _modification_time_nsec;
+	}
+
+	/** @return time of the last change to the file's data or status, or 0 if it is not known */
+	time_t change_time () const {
+		return _change_time;
+	}
+
+	/** @return nanoseconds part of the change time, or 0 if it is not known */
+	int64_t change_time_nsec () const {
+		return _change_time_nsec;
+	}
+
+	/** @return device ID, or 0 if it is not known */
+	uint64_t device () const {
+		return _device;
+	}
+
+	/** @return inode number, or 0 if it is not known */
+	uint64_t inode () const {
+		return _inode;
+	}
+
+private:
+	boost::filesystem::path _path;
+	uintmax_t _size;
+	time_t _modification_time;
+	int64_t _modification_time_nsec;
+	time_t _change_time;
+	int64_t _change_time_nsec;
+	uint64_t _device;
+	uint64_t _inode;
+};
+
+extern bool operator== (FileIdentity const & a, FileIdentity const & b);
+extern bool operator!= (FileIdentity const & a, FileIdentity const & b);
+
+}
+
+#endif
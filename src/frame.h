@@ -42,18 +42,22 @@
 
 namespace dcp {
 
+template <class R, class F>
+class AssetReader;
+
 template <class R, class B>
 class Frame : public boost::noncopyable
 {
 public:
-	Frame (R* reader, int n, boost::shared_ptr<const DecryptionContext> c)
+	/** @param decrypt false to leave the frame's ciphertext in place, if c says that
+	 *  decryption should happen after reading; decrypt() must then be called before
+	 *  the frame is used.
+	 */
+	Frame (R* reader, int n, boost::shared_ptr<const DecryptionContext> c, bool decrypt = true)
 	{
 		/* XXX: unfortunate guesswork on this buffer size */
 		_buffer = new B (Kumu::Megabyte);
-
-		if (ASDCP_FAILURE (reader->ReadFrame (n, *_buffer, c->context(), c->hmac()))) {
-			boost::throw_exception (DCPReadError ("could not read frame"));
-		}
+		read (reader, n, c, decrypt);
 	}
 
 	~Frame ()
@@ -72,6 +76,33 @@ public:
 	}
 
 private:
+	template <class, class> friend class AssetReader;
+
+	/** Read a frame into our existing buffer */
+	void read (R* reader, int n, boost::shared_ptr<const DecryptionContext> c, bool decrypt)
+	{
+		ASDCP::Result_t r;
+		if (c->decrypt_after_read ()) {
+			r = reader->ReadFrame (n, *_buffer, 0, 0);
+			if (ASDCP_SUCCESS (r) && decrypt) {
+				r = c->decrypt (*_buffer, n, n + 1);
+			}
+		} else {
+			r = reader->ReadFrame (n, *_buffer, c->context(), c->hmac());
+		}
+
+		if (ASDCP_FAILURE (r)) {
+			boost::throw_exception (DCPReadError ("could not read frame"));
+		}
+	}
+
+	void decrypt (int n, boost::shared_ptr<const DecryptionContext> c)
+	{
+		if (ASDCP_FAILURE (c->decrypt (*_buffer, n, n + 1))) {
+			boost::throw_exception (DCPReadError ("could not decrypt frame"));
+		}
+	}
+
 	B* _buffer;
 };
 
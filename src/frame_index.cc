@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/frame_index.cc
+ *  @brief FrameIndexEntry class and helpers to read MXF index tables.
+ */
+
+#include "frame_index.h"
+#include "exceptions.h"
+#include "compose.hpp"
+#include <asdcp/AS_DCP.h>
+#include <asdcp/MXF.h>
+
+using std::vector;
+using namespace dcp;
+
+/** @return Position in the file of the first byte of essence */
+static int64_t
+essence_start (ASDCP::MXF::OP1aHeader& header, ASDCP::MXF::OPAtomIndexFooter& footer)
+{
+	if (footer.PreviousPartition != 0) {
+		/* SMPTE files have a body partition just before the essence; asdcplib
+		   writes it with the same fields as the header partition pack.
+		*/
+		return footer.PreviousPartition + header.ASDCP::MXF::Partition::ArchiveSize ();
+	}
+
+	/* Interop files have the essence straight after the header metadata */
+	return header.ASDCP::MXF::Partition::ArchiveSize () + header.HeaderByteCount;
+}
+
+/** Make a list of the essence positions described by an MXF's index table.
+ *  @param header MXF header partition.
+ *  @param footer MXF footer partition, containing the index table.
+ *  @param entries Number of entries to read from the index.
+ *  @return Position and size of each entry.
+ */
+vector<FrameIndexEntry>
+dcp::read_frame_index (ASDCP::MXF::OP1aHeader& header, ASDCP::MXF::OPAtomIndexFooter& footer, int64_t entries)
+{
+	int64_t const start = essence_start (header, footer);
+
+	vector<FrameIndexEntry> index;
+	index.reserve (entries);
+
+	for (int64_t i = 0; i < entries; ++i) {
+		ASDCP::MXF::IndexTableSegment::IndexEntry entry;
+		if (ASDCP_FAILURE (footer.Lookup (i, entry))) {
+			boost::throw_exception (DCPReadError (String::compose ("could not find entry %1 in MXF index", i)));
+		}
+		index.push_back (FrameIndexEntry (start + entry.StreamOffset, 0));
+	}
+
+	/* The essence runs up to the footer, so each entry's size is the distance to the next one */
+	for (size_t i = 0; i < index.size(); ++i) {
+		int64_t const next = (i + 1) < index.size() ? index[i + 1].offset : static_cast<int64_t> (footer.ThisPartition);
+		if (next < index[i].offset) {
+			boost::throw_exception (DCPReadError ("MXF index is inconsistent"));
+		}
+		index[i].size = next - index[i].offset;
+	}
+
+	return index;
+}
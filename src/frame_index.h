@@ -0,0 +1,101 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/frame_index.h
+ *  @brief FrameIndexEntry class and helpers to read MXF index tables.
+ */
+
+#ifndef LIBDCP_FRAME_INDEX_H
+#define LIBDCP_FRAME_INDEX_H
+
+#include "exceptions.h"
+#include <asdcp/AS_DCP.h>
+#include <boost/filesystem.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace ASDCP {
+	namespace MXF {
+		class OP1aHeader;
+		class OPAtomIndexFooter;
+	}
+}
+
+namespace dcp {
+
+/** @class FrameIndexEntry
+ *  @brief The position of a frame's essence (both eyes, for a stereoscopic frame) in an MXF file.
+ */
+struct FrameIndexEntry
+{
+	FrameIndexEntry ()
+		: offset (0)
+		, size (0)
+	{}
+
+	FrameIndexEntry (int64_t o, int64_t s)
+		: offset (o)
+		, size (s)
+	{}
+
+	/** offset of the essence's KLV packet from the start of the file, in bytes */
+	int64_t offset;
+	/** size of the KLV packet (including its key and length) in bytes */
+	int64_t size;
+};
+
+extern std::vector<FrameIndexEntry> read_frame_index (
+	ASDCP::MXF::OP1aHeader& header, ASDCP::MXF::OPAtomIndexFooter& footer, int64_t entries
+	);
+
+/** Read the index table of an MXF file without reading any of its essence.
+ *  @param file MXF file.
+ *  @param entries Number of entries to read from the index.
+ *  @return Position and size of each entry.
+ */
+template <class R>
+std::vector<FrameIndexEntry>
+read_frame_index (boost::filesystem::path file, int64_t entries)
+{
+	R reader;
+	Kumu::Result_t r = reader.OpenRead (file.string().c_str());
+	if (ASDCP_FAILURE (r)) {
+		boost::throw_exception (MXFFileError ("could not open MXF file for reading", file.string(), r));
+	}
+
+	return read_frame_index (reader.OP1aHeader(), reader.OPAtomIndexFooter(), entries);
+}
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/frame_splitter.cc
+ *  @brief FrameSplitter class.
+ */
+
+#include "frame_splitter.h"
+#include "dcp_assert.h"
+#include <algorithm>
+
+using std::min;
+using std::max;
+using std::vector;
+using boost::function;
+using namespace dcp;
+
+/** @param index Index of the MXF, as returned by (for example) MonoPictureAsset::frame_index().
+ *  @param handler Function to call with the index, data and size of each frame's KLV packet(s);
+ *  the data is only valid for the duration of the call.
+ */
+FrameSplitter::FrameSplitter (vector<FrameIndexEntry> index, function<void (int64_t, uint8_t const *, int64_t)> handler)
+	: _index (index)
+	, _handler (handler)
+	, _next (0)
+{
+
+}
+
+/** Give the splitter the next block of the file.  Blocks must be given in order and without gaps.
+ *  @param offset Offset of the block from the start of the file, in bytes.
+ *  @param data Block data.
+ *  @param size Size of the block in bytes.
+ */
+void
+FrameSplitter::add (int64_t offset, uint8_t const * data, int size)
+{
+	int64_t const end = offset + size;
+
+	while (_next < int64_t (_index.size())) {
+		FrameIndexEntry const & frame = _index[_next];
+		if (frame.offset >= end) {
+			/* This frame starts in a later block */
+			return;
+		}
+
+		int64_t const frame_end = frame.offset + frame.size;
+		if (_partial.empty() && frame.offset >= offset && frame_end <= end) {
+			/* The whole frame is in this block */
+			_handler (_next, data + frame.offset - offset, frame.size);
+			++_next;
+			continue;
+		}
+
+		/* Copy the part of the frame that is in this block */
+		int64_t const from = max (frame.offset, offset);
+		int64_t const to = min (frame_end, end);
+		DCP_ASSERT (from == frame.offset + int64_t (_partial.size()));
+		_partial.insert (_partial.end(), data + from - offset, data + to - offset);
+
+		if (to < frame_end) {
+			/* The rest of the frame is in a later block */
+			return;
+		}
+
+		_handler (_next, &_partial[0], frame.size);
+		_partial.clear ();
+		++_next;
+	}
+}
@@ -0,0 +1,80 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/frame_splitter.h
+ *  @brief FrameSplitter class.
+ */
+
+#ifndef LIBDCP_FRAME_SPLITTER_H
+#define LIBDCP_FRAME_SPLITTER_H
+
+#include "frame_index.h"
+#include <boost/function.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace dcp {
+
+/** @class FrameSplitter
+ *  @brief Something which is given the blocks of an MXF file as it is read from start to
+ *  finish, and picks out the essence of each frame using the MXF's index.
+ *
+ *  This means that the frames can be checked using the same reads that are made to
+ *  hash the file.  Frames which lie entirely within one block are handed on without
+ *  being copied; others are put back together first.
+ */
+class FrameSplitter
+{
+public:
+	FrameSplitter (std::vector<FrameIndexEntry> index, boost::function<void (int64_t, uint8_t const *, int64_t)> handler);
+
+	void add (int64_t offset, uint8_t const * data, int size);
+
+	/** @return number of frames which have been handed on */
+	int64_t frames () const {
+		return _next;
+	}
+
+private:
+	std::vector<FrameIndexEntry> _index;
+	/** function to call with the index, data and size of each frame */
+	boost::function<void (int64_t, uint8_t const *, int64_t)> _handler;
+	/** index of the next frame to hand on */
+	int64_t _next;
+	/** the part of frame _next that we have been given so far, if it spans more than one block */
+	std::vector<uint8_t> _partial;
+};
+
+}
+
+#endif
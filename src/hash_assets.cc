@@ -0,0 +1,263 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/hash_assets.cc
+ *  @brief process_assets and hash_assets functions.
+ */
+
+#include "hash_assets.h"
+#include "asset.h"
+#include "file_identity.h"
+#include "exceptions.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/exception_ptr.hpp>
+#include <map>
+#include <set>
+#include <vector>
+
+using std::list;
+using std::map;
+using std::set;
+using std::vector;
+using boost::shared_ptr;
+using boost::function;
+using namespace dcp;
+
+/** State shared by the threads of process_assets() */
+struct ProcessState
+{
+	ProcessState ()
+		: total (0)
+		, done (0)
+		, remaining (0)
+		, threads_per_device (0)
+	{}
+
+	vector<shared_ptr<Asset> > assets;
+	/** size of each asset's file in bytes */
+	vector<uintmax_t> sizes;
+	/** device that each asset's file is on */
+	vector<uint64_t> devices;
+	/** proportion of each asset that has been hashed */
+	vector<float> progress;
+	/** true for each asset which a thread has started to hash */
+	vector<bool> started;
+	uintmax_t total;
+	/** number of bytes hashed so far */
+	double done;
+	/** number of assets which no thread has started to hash */
+	size_t remaining;
+	/** number of threads hashing assets on each device */
+	map<uint64_t, int> busy;
+	int threads_per_device;
+	function<void (shared_ptr<Asset>, function<void (float)>)> process;
+	function<void (float)> progress_handler;
+	boost::exception_ptr error;
+	/** mutex to protect everything except assets, sizes, devices, total, threads_per_device and process */
+	boost::mutex mutex;
+	/** condition which is signalled when a thread finishes with an asset */
+	boost::condition_variable finished;
+};
+
+static void
+process_progress (ProcessState* state, size_t index, float progress)
+{
+	boost::mutex::scoped_lock lm (state->mutex);
+	state->done += (progress - state->progress[index]) * state->sizes[index];
+	state->progress[index] = progress;
+	if (state->progress_handler && state->total > 0) {
+		state->progress_handler (state->done / state->total);
+	}
+}
+
+/** Find the next asset that a thread may hash.  state->mutex must be held.
+ *  @return Index of the asset, or -1 if none is available at the moment.
+ */
+static int
+next_asset (ProcessState* state)
+{
+	for (size_t i = 0; i < state->assets.size(); ++i) {
+		if (state->started[i]) {
+			continue;
+		}
+		if (state->threads_per_device > 0 && state->busy[state->devices[i]] >= state->threads_per_device) {
+			continue;
+		}
+		return i;
+	}
+
+	return -1;
+}
+
+static void
+process_worker (ProcessState* state)
+{
+	while (true) {
+		int index;
+		{
+			boost::mutex::scoped_lock lm (state->mutex);
+			while (true) {
+				if (state->error || state->remaining == 0) {
+					return;
+				}
+				index = next_asset (state);
+				if (index != -1) {
+					break;
+				}
+				/* Everything that is left is on devices which are busy */
+				state->finished.wait (lm);
+			}
+
+			state->started[index] = true;
+			--state->remaining;
+			++state->busy[state->devices[index]];
+		}
+
+		try {
+			state->process (state->assets[index], boost::bind (&process_progress, state, index, _1));
+			process_progress (state, index, 1);
+		} catch (...) {
+			boost::mutex::scoped_lock lm (state->mutex);
+			if (!state->error) {
+				state->error = boost::current_exception ();
+			}
+		}
+
+		{
+			boost::mutex::scoped_lock lm (state->mutex);
+			--state->busy[state->devices[index]];
+		}
+
+		state->finished.notify_all ();
+	}
+}
+
+/** Do something to each of some assets, using several threads at once.
+ *  @param assets Assets; any without files are ignored, and each asset is processed only once
+ *  however many times it appears.
+ *  @param process Function to process an asset, which is given the asset and a function to
+ *  call with progress (from 0 to 1) through the asset.
+ *  @param threads Number of threads to use.
+ *  @param progress Function to call with the overall progress (from 0 to 1); this may
+ *  be called from any of the threads, but never from two at once.
+ *  @param threads_per_device Maximum number of threads which may read from any one
+ *  storage device at once, or 0 for no limit.
+ */
+void
+dcp::process_assets (
+	list<shared_ptr<Asset> > assets,
+	function<void (shared_ptr<Asset>, function<void (float)>)> process,
+	int threads,
+	function<void (float)> progress,
+	int threads_per_device
+	)
+{
+	ProcessState state;
+	state.process = process;
+	state.progress_handler = progress;
+	state.threads_per_device = threads_per_device;
+
+	set<shared_ptr<Asset> > seen;
+	BOOST_FOREACH (shared_ptr<Asset> i, assets) {
+		/* The same asset can be in more than one CPL, and two threads must not process it at once */
+		if (!i->file() || seen.find(i) != seen.end()) {
+			continue;
+		}
+		seen.insert (i);
+		state.assets.push_back (i);
+		/* If the file can't be read, processing the asset will report it in the usual way,
+		   so for now just count it as empty.
+		*/
+		boost::system::error_code ec;
+		uintmax_t const size = boost::filesystem::file_size (i->file().get(), ec);
+		state.sizes.push_back (ec ? 0 : size);
+		uint64_t device = 0;
+		if (threads_per_device > 0) {
+			try {
+				device = FileIdentity(i->file().get()).device();
+			} catch (FileError &) {
+
+			}
+		}
+		state.devices.push_back (device);
+		state.progress.push_back (0);
+		state.started.push_back (false);
+		state.total += state.sizes.back ();
+	}
+
+	state.remaining = state.assets.size ();
+
+	boost::thread_group group;
+	for (int i = 1; i < std::min (threads, static_cast<int> (state.assets.size())); ++i) {
+		group.create_thread (boost::bind (&process_worker, &state));
+	}
+
+	/* This thread does its share too */
+	process_worker (&state);
+	group.join_all ();
+
+	if (state.error) {
+		boost::rethrow_exception (state.error);
+	}
+}
+
+static void
+hash_asset (shared_ptr<Asset> asset, function<void (float)> progress, ReadCacheMode mode, shared_ptr<RateLimiter> limiter)
+{
+	asset->hash (progress, mode, limiter);
+}
+
+/** Make sure that the hashes of some assets have been computed, using several threads at once.
+ *  @param assets Assets; any without files are ignored.
+ *  @param threads Number of threads to use.
+ *  @param progress Function to call with the overall progress (from 0 to 1); this may
+ *  be called from any of the threads, but never from two at once.
+ *  @param threads_per_device Maximum number of threads which may read from any one
+ *  storage device at once, or 0 for no limit.
+ *  @param mode How reads of the assets should treat the page cache.
+ *  @param limiter Rate limiter to use for reads of the assets, or 0.
+ */
+void
+dcp::hash_assets (
+	list<shared_ptr<Asset> > assets,
+	int threads,
+	function<void (float)> progress,
+	int threads_per_device,
+	ReadCacheMode mode,
+	shared_ptr<RateLimiter> limiter
+	)
+{
+	process_assets (assets, boost::bind (&hash_asset, _1, _2, mode, limiter), threads, progress, threads_per_device);
+}
@@ -0,0 +1,70 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/hash_assets.h
+ *  @brief process_assets and hash_assets functions.
+ */
+
+#ifndef LIBDCP_HASH_ASSETS_H
+#define LIBDCP_HASH_ASSETS_H
+
+#include "types.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <list>
+
+namespace dcp {
+
+class Asset;
+class RateLimiter;
+
+extern void process_assets (
+	std::list<boost::shared_ptr<Asset> > assets,
+	boost::function<void (boost::shared_ptr<Asset>, boost::function<void (float)>)> process,
+	int threads,
+	boost::function<void (float)> progress,
+	int threads_per_device = 0
+	);
+
+extern void hash_assets (
+	std::list<boost::shared_ptr<Asset> > assets,
+	int threads,
+	boost::function<void (float)> progress,
+	int threads_per_device = 0,
+	ReadCacheMode mode = READ_CACHE_DEFAULT,
+	boost::shared_ptr<RateLimiter> limiter = boost::shared_ptr<RateLimiter> ()
+	);
+
+}
+
+#endif
@@ -0,0 +1,173 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/hmac_checker.cc
+ *  @brief HMACChecker class.
+ */
+
+#include "hmac_checker.h"
+#include "aes_decryptor.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <cstring>
+
+using boost::shared_ptr;
+using boost::function;
+using namespace dcp;
+
+/** Number of frames that can be waiting to be checked before add() blocks */
+static std::list<int>::size_type const max_queue_length = 64;
+
+HMACChecker::HMACChecker (shared_ptr<const AESDecryptor> decryptor, function<void (int)> mismatch)
+	: _decryptor (decryptor)
+	, _mismatch (mismatch)
+	, _checking (false)
+	, _finishing (false)
+	, _thread (0)
+{
+	_thread = new boost::thread (boost::bind (&HMACChecker::thread, this));
+}
+
+HMACChecker::~HMACChecker ()
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_finishing = true;
+	}
+
+	_condition.notify_all ();
+	_thread->join ();
+	delete _thread;
+}
+
+/** Throw any error from the mismatch handler.  _mutex must be held.  The error is kept,
+ *  so that it is thrown again by every later call, since any checks after it were discarded.
+ */
+void
+HMACChecker::rethrow ()
+{
+	if (_error) {
+		boost::rethrow_exception (_error);
+	}
+}
+
+/** Queue a frame to have its HMAC checked.
+ *  @param buffer Frame as read with no context; this will be copied, so it may be decrypted
+ *  as soon as this method returns.
+ *  @param asset_id UUID of the asset that the frame came from (ASDCP::UUIDlen bytes).
+ *  @param frame Index of the frame to pass to the mismatch handler if the check fails.
+ *  @param sequence Sequence number of the frame in the MXF, starting from 1.
+ */
+void
+HMACChecker::add (ASDCP::FrameBuffer const & buffer, uint8_t const * asset_id, int frame, uint32_t sequence)
+{
+	Check check;
+	check.buffer.reset (new ASDCP::FrameBuffer);
+	check.buffer->Capacity (buffer.Size ());
+	memcpy (check.buffer->Data(), buffer.RoData(), buffer.Size());
+	check.buffer->Size (buffer.Size ());
+	check.buffer->SourceLength (buffer.SourceLength ());
+	check.buffer->PlaintextOffset (buffer.PlaintextOffset ());
+	memcpy (check.asset_id, asset_id, ASDCP::UUIDlen);
+	check.frame = frame;
+	check.sequence = sequence;
+
+	boost::mutex::scoped_lock lm (_mutex);
+	while (_queue.size() >= max_queue_length && !_error) {
+		_condition.wait (lm);
+	}
+
+	rethrow ();
+
+	_queue.push_back (check);
+	_condition.notify_all ();
+}
+
+/** Wait until all the frames that have been added have been checked, throwing any
+ *  exception from the mismatch handler.
+ */
+void
+HMACChecker::flush ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	while (!_queue.empty() || _checking) {
+		_condition.wait (lm);
+	}
+
+	rethrow ();
+}
+
+void
+HMACChecker::thread ()
+{
+	while (true) {
+		boost::mutex::scoped_lock lm (_mutex);
+		while (_queue.empty() && !_finishing) {
+			_condition.wait (lm);
+		}
+
+		if (_queue.empty ()) {
+			/* _finishing must be set and there's nothing left to do */
+			return;
+		}
+
+		Check check = _queue.front ();
+		_queue.pop_front ();
+
+		if (_error) {
+			/* The mismatch handler has already failed, so don't check anything else */
+			_condition.notify_all ();
+			continue;
+		}
+
+		_checking = true;
+		/* There's now room in the queue */
+		_condition.notify_all ();
+		lm.unlock ();
+
+		if (ASDCP_FAILURE (_decryptor->check_hmac (*check.buffer, check.asset_id, check.sequence)) && _mismatch) {
+			/* An exception must not escape this thread, so keep it to throw from add() or flush() */
+			try {
+				_mismatch (check.frame);
+			} catch (...) {
+				lm.lock ();
+				_error = boost::current_exception ();
+				lm.unlock ();
+			}
+		}
+
+		lm.lock ();
+		_checking = false;
+		_condition.notify_all ();
+	}
+}
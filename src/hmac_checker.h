@@ -0,0 +1,110 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/hmac_checker.h
+ *  @brief HMACChecker class.
+ */
+
+#ifndef LIBDCP_HMAC_CHECKER_H
+#define LIBDCP_HMAC_CHECKER_H
+
+#include <asdcp/AS_DCP.h>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/exception_ptr.hpp>
+#include <list>
+#include <stdint.h>
+
+namespace boost {
+	class thread;
+}
+
+namespace dcp {
+
+class AESDecryptor;
+
+/** @class HMACChecker
+ *  @brief A thread which checks the HMACs of encrypted frames after they have been handed out.
+ *
+ *  Frames are copied (still encrypted) into a queue by add(), and their integrity packs are checked
+ *  in the background.  If a check fails the mismatch handler is called, from the checking thread,
+ *  with the index of the frame.  The queue is bounded so that add() will block if the checks fall
+ *  a long way behind; every frame that is added is checked, including when the HMACChecker is
+ *  destroyed with checks still waiting.
+ *
+ *  If the mismatch handler throws an exception, later checks are discarded and the exception is
+ *  thrown from the next call to add() or flush(), and from every call after that.
+ */
+class HMACChecker : public boost::noncopyable
+{
+public:
+	HMACChecker (boost::shared_ptr<const AESDecryptor> decryptor, boost::function<void (int)> mismatch);
+	~HMACChecker ();
+
+	void add (ASDCP::FrameBuffer const & buffer, uint8_t const * asset_id, int frame, uint32_t sequence);
+	void flush ();
+
+private:
+	void thread ();
+	void rethrow ();
+
+	struct Check
+	{
+		boost::shared_ptr<ASDCP::FrameBuffer> buffer;
+		uint8_t asset_id[ASDCP::UUIDlen];
+		int frame;
+		uint32_t sequence;
+	};
+
+	boost::shared_ptr<const AESDecryptor> _decryptor;
+	boost::function<void (int)> _mismatch;
+
+	/** mutex to protect _queue, _checking, _finishing and _error */
+	boost::mutex _mutex;
+	boost::condition_variable _condition;
+	std::list<Check> _queue;
+	/** true if the thread is checking a frame which it has taken from _queue */
+	bool _checking;
+	/** true if the thread should finish once _queue is empty */
+	bool _finishing;
+	/** exception thrown by the mismatch handler, if any */
+	boost::exception_ptr _error;
+	boost::thread* _thread;
+};
+
+}
+
+#endif
@@ -47,11 +47,18 @@ using std::list;
 using std::pair;
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
+using boost::optional;
 using namespace dcp;
 
 MonoPictureAsset::MonoPictureAsset (boost::filesystem::path file)
 	: PictureAsset (file)
 {
+	optional<string> id = read_cache (file, "MonoPicture");
+	if (id) {
+		_id = *id;
+		return;
+	}
+
 	ASDCP::JP2K::MXFReader reader;
 	Kumu::Result_t r = reader.OpenRead (file.string().c_str());
 	if (ASDCP_FAILURE (r)) {
@@ -71,6 +78,7 @@ MonoPictureAsset::MonoPictureAsset (boost::filesystem::path file)
 	}
 
 	_id = read_writer_info (info);
+	write_cache (file, "MonoPicture", _id);
 }
 
 MonoPictureAsset::MonoPictureAsset (Fraction edit_rate, Standard standard)
@@ -179,6 +187,14 @@ MonoPictureAsset::start_read () const
 	return shared_ptr<MonoPictureAssetReader> (new MonoPictureAssetReader (this, key(), standard()));
 }
 
+vector<FrameIndexEntry>
+MonoPictureAsset::frame_index () const
+{
+	DCP_ASSERT (_file);
+
+	return cached_frame_index<ASDCP::JP2K::MXFReader> (_file.get(), _intrinsic_duration);
+}
+
 string
 MonoPictureAsset::cpl_node_name () const
 {
@@ -62,6 +62,8 @@ public:
 	boost::shared_ptr<PictureAssetWriter> start_write (boost::filesystem::path, bool);
 	boost::shared_ptr<MonoPictureAssetReader> start_read () const;
 
+	std::vector<FrameIndexEntry> frame_index () const;
+
 	bool equals (
 		boost::shared_ptr<const Asset> other,
 		EqualityOptions opt,
@@ -40,6 +40,7 @@
 #include "picture_asset.h"
 #include "dcp_assert.h"
 #include "crypto_context.h"
+#include "util.h"
 #include <asdcp/AS_DCP.h>
 #include <asdcp/KM_fileio.h>
 
@@ -64,11 +65,18 @@ MonoPictureAssetWriter::MonoPictureAssetWriter (PictureAsset* asset, boost::file
 
 }
 
+MonoPictureAssetWriter::~MonoPictureAssetWriter ()
+{
+	/* Queued writes use _state, so they must finish before it goes away */
+	stop_asynchronous ();
+}
+
 void
 MonoPictureAssetWriter::start (uint8_t const * data, int size)
 {
 	dcp::start (this, _state, _picture_asset, data, size);
 	_picture_asset->set_frame_rate (_picture_asset->edit_rate());
+	skip_resumed_frames ();
 }
 
 FrameInfo
@@ -80,20 +88,23 @@ MonoPictureAssetWriter::write (uint8_t const * data, int size)
 		start (data, size);
 	}
 
- 	if (ASDCP_FAILURE (_state->j2k_parser.OpenReadFrame (data, size, _state->frame_buffer))) {
- 		boost::throw_exception (MiscError ("could not parse J2K frame"));
- 	}
+	int64_t const parse_start = monotonic_microseconds ();
+	ASDCP::JP2K::FrameBuffer const & buffer = prepare_frame (_state.get(), data, size);
+	int64_t const write_start = monotonic_microseconds ();
 
 	uint64_t const before_offset = _state->mxf_writer.Tell ();
 
 	string hash;
-	ASDCP::Result_t const r = _state->mxf_writer.WriteFrame (_state->frame_buffer, _crypto_context->context(), _crypto_context->hmac(), &hash);
+	ASDCP::Result_t const r = _state->mxf_writer.WriteFrame (buffer, _crypto_context->context(), _crypto_context->hmac(), &hash);
 	if (ASDCP_FAILURE (r)) {
 		boost::throw_exception (MXFFileError ("error in writing video MXF", _file.string(), r));
 	}
 
-	++_frames_written;
-	return FrameInfo (before_offset, _state->mxf_writer.Tell() - before_offset, hash);
+	frame_written ();
+	FrameInfo const info (before_offset, _state->mxf_writer.Tell() - before_offset, hash);
+	add_stats (info.size, write_start - parse_start, monotonic_microseconds () - write_start);
+	add_to_journal (info);
+	return info;
 }
 
 void
@@ -107,19 +118,25 @@ MonoPictureAssetWriter::fake_write (int size)
 		boost::throw_exception (MXFFileError ("error in writing video MXF", _file.string(), r));
 	}
 
-	++_frames_written;
+	frame_written ();
 }
 
 bool
 MonoPictureAssetWriter::finalize ()
 {
+	check_reorder_buffer ();
+	drain ();
+
 	if (_started) {
 		Kumu::Result_t r = _state->mxf_writer.Finalize();
 		if (ASDCP_FAILURE (r)) {
 			boost::throw_exception (MXFFileError ("error in finalizing video MXF", _file.string(), r));
 		}
+		if (_hash_on_finalize) {
+			_picture_asset->set_hash (make_digest (_file, 0));
+		}
 	}
 
-	_picture_asset->_intrinsic_duration = _frames_written;
+	_picture_asset->_intrinsic_duration = frames_written ();
 	return PictureAssetWriter::finalize ();
 }
@@ -59,6 +59,10 @@ namespace dcp {
 class MonoPictureAssetWriter : public PictureAssetWriter
 {
 public:
+	~MonoPictureAssetWriter ();
+
+	using PictureAssetWriter::write;
+
 	FrameInfo write (uint8_t const *, int);
 	void fake_write (int size);
 	bool finalize ();
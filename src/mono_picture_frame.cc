@@ -77,19 +77,39 @@ MonoPictureFrame::MonoPictureFrame (boost::filesystem::path path)
  *  @param reader Reader for the asset's MXF file.
  *  @param n Frame within the asset, not taking EntryPoint into account.
  *  @param c Context for decryption, or 0.
+ *  @param decrypt false to leave the ciphertext in place if c says that decryption
+ *  should happen after reading; decrypt() must then be called.
  */
-MonoPictureFrame::MonoPictureFrame (ASDCP::JP2K::MXFReader* reader, int n, shared_ptr<DecryptionContext> c)
+MonoPictureFrame::MonoPictureFrame (ASDCP::JP2K::MXFReader* reader, int n, shared_ptr<DecryptionContext> c, bool decrypt)
 {
 	/* XXX: unfortunate guesswork on this buffer size */
 	_buffer = new ASDCP::JP2K::FrameBuffer (4 * Kumu::Megabyte);
 
-	ASDCP::Result_t const r = reader->ReadFrame (n, *_buffer, c->context(), c->hmac());
+	ASDCP::Result_t r;
+	if (c->decrypt_after_read ()) {
+		r = reader->ReadFrame (n, *_buffer, 0, 0);
+		if (ASDCP_SUCCESS (r) && decrypt) {
+			r = c->decrypt (*_buffer, n, n + 1);
+		}
+	} else {
+		r = reader->ReadFrame (n, *_buffer, c->context(), c->hmac());
+	}
 
 	if (ASDCP_FAILURE (r)) {
 		boost::throw_exception (DCPReadError (String::compose ("could not read video frame %1 (%2)", n, static_cast<int>(r))));
 	}
 }
 
+/** Decrypt a frame which was constructed with decrypt set to false */
+void
+MonoPictureFrame::decrypt (int n, shared_ptr<const DecryptionContext> c)
+{
+	ASDCP::Result_t const r = c->decrypt (*_buffer, n, n + 1);
+	if (ASDCP_FAILURE (r)) {
+		boost::throw_exception (DCPReadError (String::compose ("could not decrypt video frame %1 (%2)", n, static_cast<int>(r))));
+	}
+}
+
 MonoPictureFrame::MonoPictureFrame (uint8_t const * data, int size)
 {
 	_buffer = new ASDCP::JP2K::FrameBuffer (size);
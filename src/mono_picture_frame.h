@@ -81,7 +81,8 @@ private:
 	*/
 	friend class AssetReader<ASDCP::JP2K::MXFReader, MonoPictureFrame>;
 
-	MonoPictureFrame (ASDCP::JP2K::MXFReader* reader, int n, boost::shared_ptr<DecryptionContext>);
+	MonoPictureFrame (ASDCP::JP2K::MXFReader* reader, int n, boost::shared_ptr<DecryptionContext>, bool decrypt = true);
+	void decrypt (int n, boost::shared_ptr<const DecryptionContext> c);
 
 	ASDCP::JP2K::FrameBuffer* _buffer;
 };
@@ -42,19 +42,25 @@
 #include "exceptions.h"
 #include "dcp_assert.h"
 #include "compose.hpp"
+#include "mxf_cache.h"
 #include <asdcp/AS_DCP.h>
 #include <asdcp/KM_prng.h>
 #include <asdcp/KM_util.h>
-#include <libxml++/nodes/element.h>
+#include <libxml++/libxml++.h>
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
 #include <iostream>
+#include <cstdlib>
+#include <inttypes.h>
 
 using std::string;
 using std::cout;
 using std::list;
 using std::pair;
+using std::vector;
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
+using boost::optional;
 using namespace dcp;
 
 MXF::MXF ()
@@ -143,3 +149,132 @@ MXF::read_writer_info (ASDCP::WriterInfo const & info)
 	Kumu::bin2UUIDhex (info.AssetUUID, ASDCP::UUIDlen, buffer, sizeof (buffer));
 	return buffer;
 }
+
+/** Try to fill in our details from the MXF cache.
+ *  @param file MXF file.
+ *  @param type Type of MXF that we are expecting.
+ *  @return Asset ID if the cache has up-to-date details of file, otherwise empty.
+ */
+optional<string>
+MXF::read_cache (boost::filesystem::path file, string type)
+{
+	shared_ptr<cxml::Document> cache = read_mxf_cache (file, "descriptor");
+	if (!cache) {
+		return optional<string> ();
+	}
+
+	try {
+		if (cache->string_child ("Type") != type) {
+			return optional<string> ();
+		}
+
+		string const id = cache->string_child ("Id");
+		_key_id = cache->optional_string_child ("KeyId");
+		_standard = cache->string_child ("Standard") == "SMPTE" ? SMPTE : INTEROP;
+		_metadata.company_name = cache->string_child ("CompanyName");
+		_metadata.product_name = cache->string_child ("ProductName");
+		_metadata.product_version = cache->string_child ("ProductVersion");
+		read_cache_descriptor (cache->node_child ("Descriptor"));
+		return id;
+	} catch (std::exception &) {
+		/* Fall back to reading the MXF */
+		_key_id = optional<string> ();
+	}
+
+	return optional<string> ();
+}
+
+static void
+write_cache_details (
+	xmlpp::Element* root, string type, string id, optional<string> key_id, Standard standard, MXFMetadata metadata, xmlpp::Document* descriptor
+	)
+{
+	root->add_child("Type")->add_child_text (type);
+	root->add_child("Id")->add_child_text (id);
+	if (key_id) {
+		root->add_child("KeyId")->add_child_text (*key_id);
+	}
+	root->add_child("Standard")->add_child_text (standard == SMPTE ? "SMPTE" : "Interop");
+	root->add_child("CompanyName")->add_child_text (metadata.company_name);
+	root->add_child("ProductName")->add_child_text (metadata.product_name);
+	root->add_child("ProductVersion")->add_child_text (metadata.product_version);
+	root->import_node (descriptor->get_root_node ());
+}
+
+/** Write our details to the MXF cache, if it is enabled.
+ *  @param file MXF file.
+ *  @param type Type of MXF.
+ *  @param id Asset ID.
+ */
+void
+MXF::write_cache (boost::filesystem::path file, string type, string id) const
+{
+	if (!mxf_cache_directory ()) {
+		return;
+	}
+
+	xmlpp::Document descriptor;
+	write_cache_descriptor (descriptor.create_root_node ("Descriptor"));
+	write_mxf_cache (file, "descriptor", boost::bind (&write_cache_details, _1, type, id, _key_id, standard(), _metadata, &descriptor));
+}
+
+optional<vector<FrameIndexEntry> >
+MXF::read_cached_frame_index (boost::filesystem::path file, int64_t entries) const
+{
+	shared_ptr<cxml::Document> cache = read_mxf_cache (file, "index");
+	if (!cache) {
+		return optional<vector<FrameIndexEntry> > ();
+	}
+
+	try {
+		cxml::ConstNodePtr node = cache->node_child ("Index");
+		int64_t offset = node->number_attribute<int64_t> ("Start");
+
+		/* The index is a list of sizes of contiguous pieces of essence */
+		vector<FrameIndexEntry> index;
+		index.reserve (entries);
+		string const sizes = node->content ();
+		char const * p = sizes.c_str ();
+		while (true) {
+			char* end;
+			int64_t const size = strtoll (p, &end, 10);
+			if (end == p) {
+				break;
+			}
+			index.push_back (FrameIndexEntry (offset, size));
+			offset += size;
+			p = end;
+		}
+
+		if (static_cast<int64_t> (index.size()) == entries) {
+			return index;
+		}
+	} catch (std::exception &) {
+		/* Fall back to reading the MXF */
+	}
+
+	return optional<vector<FrameIndexEntry> > ();
+}
+
+static void
+write_cache_index (xmlpp::Element* root, vector<FrameIndexEntry> const * index)
+{
+	xmlpp::Element* node = root->add_child ("Index");
+	node->set_attribute ("Start", raw_convert<string> (index->empty() ? 0 : index->front().offset));
+
+	string sizes;
+	sizes.reserve (index->size() * 8);
+	char buffer[32];
+	for (vector<FrameIndexEntry>::const_iterator i = index->begin(); i != index->end(); ++i) {
+		snprintf (buffer, sizeof (buffer), "%" PRId64 " ", i->size);
+		sizes += buffer;
+	}
+	node->add_child_text (sizes);
+}
+
+void
+MXF::write_cached_frame_index (boost::filesystem::path file) const
+{
+	DCP_ASSERT (_frame_index);
+	write_mxf_cache (file, "index", boost::bind (&write_cache_index, _1, &_frame_index.get()));
+}
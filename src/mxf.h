@@ -38,7 +38,8 @@
 #include "key.h"
 #include "metadata.h"
 #include "dcp_assert.h"
-
+#include "frame_index.h"
+#include <libcxml/cxml.h>
 #include <boost/signals2.hpp>
 
 namespace ASDCP {
@@ -46,6 +47,10 @@ namespace ASDCP {
 	struct WriterInfo;
 }
 
+namespace xmlpp {
+	class Element;
+}
+
 /* Undefine some stuff that the OS X 10.5 SDK defines */
 #undef Key
 #undef set_key
@@ -130,6 +135,33 @@ protected:
 	 */
 	void fill_writer_info (ASDCP::WriterInfo* w, std::string id) const;
 
+	boost::optional<std::string> read_cache (boost::filesystem::path file, std::string type);
+	void write_cache (boost::filesystem::path file, std::string type, std::string id) const;
+
+	/** Read the details that are specific to a type of MXF from a cache entry */
+	virtual void read_cache_descriptor (cxml::ConstNodePtr) {}
+	/** Write the details that are specific to a type of MXF to a cache entry */
+	virtual void write_cache_descriptor (xmlpp::Element *) const {}
+
+	/** @param file MXF file.
+	 *  @param entries Number of entries that the index should have.
+	 *  @return Frame index of file, from memory, the MXF cache or the file itself (in that order of preference).
+	 */
+	template <class R>
+	std::vector<FrameIndexEntry> cached_frame_index (boost::filesystem::path file, int64_t entries) const
+	{
+		if (!_frame_index) {
+			_frame_index = read_cached_frame_index (file, entries);
+		}
+
+		if (!_frame_index) {
+			_frame_index = read_frame_index<R> (file, entries);
+			write_cached_frame_index (file);
+		}
+
+		return _frame_index.get ();
+	}
+
 	/** ID of the key used for encryption/decryption, if there is one */
 	boost::optional<std::string> _key_id;
 	/** Key used for encryption/decryption, if there is one */
@@ -137,6 +169,12 @@ protected:
 	std::string _context_id;
 	MXFMetadata _metadata;
 	boost::optional<Standard> _standard;
+	/** Positions of the essence in our file, if they have been read */
+	mutable boost::optional<std::vector<FrameIndexEntry> > _frame_index;
+
+private:
+	boost::optional<std::vector<FrameIndexEntry> > read_cached_frame_index (boost::filesystem::path file, int64_t entries) const;
+	void write_cached_frame_index (boost::filesystem::path file) const;
 };
 
 }
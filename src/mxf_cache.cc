@@ -0,0 +1,252 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/mxf_cache.cc
+ *  @brief Optional on-disk cache of details read from MXF headers and index tables.
+ */
+
+#include "mxf_cache.h"
+#include "file_identity.h"
+#include "util.h"
+#include <libxml++/libxml++.h>
+#include <openssl/sha.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
+#include <cstdio>
+
+using std::string;
+using boost::shared_ptr;
+using boost::optional;
+using boost::function;
+using namespace dcp;
+
+/** mutex to protect cache_directory and digest_directory */
+static boost::mutex cache_directory_mutex;
+static optional<boost::filesystem::path> cache_directory;
+static optional<boost::filesystem::path> digest_directory;
+
+/** Set the directory to use to cache MXF details.
+ *  @param directory Directory, which will be created if required, or empty to disable the cache.
+ */
+void
+dcp::set_mxf_cache_directory (optional<boost::filesystem::path> directory)
+{
+	boost::mutex::scoped_lock lm (cache_directory_mutex);
+	cache_directory = directory;
+}
+
+/** @return Directory used to cache MXF details, or empty if the cache is disabled */
+optional<boost::filesystem::path>
+dcp::mxf_cache_directory ()
+{
+	boost::mutex::scoped_lock lm (cache_directory_mutex);
+	return cache_directory;
+}
+
+/** @return Path of the cache file for a part of the details of an MXF */
+static boost::filesystem::path
+cache_file (boost::filesystem::path directory, FileIdentity const & identity, string part)
+{
+	string const path = identity.path().string ();
+	unsigned char digest[SHA_DIGEST_LENGTH];
+	SHA1 (reinterpret_cast<unsigned char const *> (path.c_str()), path.length(), digest);
+
+	char name[SHA_DIGEST_LENGTH * 2 + 1];
+	for (int i = 0; i < SHA_DIGEST_LENGTH; ++i) {
+		snprintf (name + i * 2, 3, "%02x", digest[i]);
+	}
+
+	return directory / (string (name) + "." + part + ".xml");
+}
+
+/** Read a cache file for a file on disk.
+ *  @param directory Cache directory.
+ *  @param file File that the cache is for.
+ *  @param part Name of the part of the details to read.
+ *  @param root Name of the cache file's root node.
+ *  @return Cache file, or 0 if there is none, or if it does not match the current state of file.
+ */
+static shared_ptr<cxml::Document>
+read_cache (boost::filesystem::path directory, boost::filesystem::path file, string part, string root)
+{
+	try {
+		FileIdentity const identity (file);
+		boost::filesystem::path const cache = cache_file (directory, identity, part);
+		if (!boost::filesystem::exists (cache)) {
+			return shared_ptr<cxml::Document> ();
+		}
+
+		shared_ptr<cxml::Document> doc (new cxml::Document (root));
+		doc->read_file (cache);
+		if (FileIdentity (doc->node_child ("Identity")) != identity) {
+			return shared_ptr<cxml::Document> ();
+		}
+		return doc;
+	} catch (std::exception &) {
+		/* Any problem with the cache means we just read the file */
+	}
+
+	return shared_ptr<cxml::Document> ();
+}
+
+/** Write a cache file for a file on disk.
+ *  @param directory Cache directory, which will be created if required.
+ *  @param identity Identity of the file that the cache is for.
+ *  @param part Name of the part of the details to write.
+ *  @param root Name of the cache file's root node.
+ *  @param fill Function to add the details to the cache's root node.
+ */
+static void
+write_cache (boost::filesystem::path directory, FileIdentity const & identity, string part, string root, function<void (xmlpp::Element *)> fill)
+{
+	try {
+		boost::filesystem::create_directories (directory);
+
+		xmlpp::Document doc;
+		xmlpp::Element* root_node = doc.create_root_node (root);
+		identity.as_xml (root_node->add_child ("Identity"));
+		fill (root_node);
+
+		/* Write to a temporary file and rename it so that other readers of the cache
+		   never see a partly-written file.
+		*/
+		boost::filesystem::path const file = cache_file (directory, identity, part);
+		boost::filesystem::path const temp = file.string() + "." + make_uuid() + ".tmp";
+		doc.write_to_file (temp.string(), "UTF-8");
+		boost::filesystem::rename (temp, file);
+	} catch (std::exception &) {
+		/* The cache is only an optimisation, so failing to write to it is not an error */
+	}
+}
+
+/** Read some cached details of an MXF.
+ *  @param mxf MXF file.
+ *  @param part Name of the part of the details to read.
+ *  @return Cached details, or 0 if there are none, or if those that there are do not
+ *  match the current state of the MXF.
+ */
+shared_ptr<cxml::Document>
+dcp::read_mxf_cache (boost::filesystem::path mxf, string part)
+{
+	optional<boost::filesystem::path> directory = mxf_cache_directory ();
+	if (!directory) {
+		return shared_ptr<cxml::Document> ();
+	}
+
+	return read_cache (*directory, mxf, part, "MXFCache");
+}
+
+/** Write some details of an MXF to the cache, if it is enabled.
+ *  @param mxf MXF file.
+ *  @param part Name of the part of the details to write.
+ *  @param fill Function to add the details to the cache's root node.
+ */
+void
+dcp::write_mxf_cache (boost::filesystem::path mxf, string part, function<void (xmlpp::Element *)> fill)
+{
+	optional<boost::filesystem::path> directory = mxf_cache_directory ();
+	if (!directory) {
+		return;
+	}
+
+	try {
+		write_cache (*directory, FileIdentity (mxf), part, "MXFCache", fill);
+	} catch (std::exception &) {
+		/* FileIdentity failed; as above, this is not an error */
+	}
+}
+
+/** Set the directory to use to cache the digests of files.
+ *  @param directory Directory, which will be created if required, or empty to disable the cache.
+ */
+void
+dcp::set_digest_cache_directory (optional<boost::filesystem::path> directory)
+{
+	boost::mutex::scoped_lock lm (cache_directory_mutex);
+	digest_directory = directory;
+}
+
+/** @return Directory used to cache digests, or empty if the cache is disabled */
+optional<boost::filesystem::path>
+dcp::digest_cache_directory ()
+{
+	boost::mutex::scoped_lock lm (cache_directory_mutex);
+	return digest_directory;
+}
+
+/** @return Cached digest of a file, if the digest cache is enabled and it has an up-to-date digest */
+optional<string>
+dcp::read_digest_cache (boost::filesystem::path file)
+{
+	optional<boost::filesystem::path> directory = digest_cache_directory ();
+	if (!directory) {
+		return optional<string> ();
+	}
+
+	shared_ptr<cxml::Document> doc = read_cache (*directory, file, "digest", "DigestCache");
+	if (!doc) {
+		return optional<string> ();
+	}
+
+	return doc->optional_string_child ("Digest");
+}
+
+static void
+write_digest (xmlpp::Element* node, string digest)
+{
+	node->add_child("Digest")->add_child_text (digest);
+}
+
+/** Write a digest to the cache, if it is enabled.
+ *  @param identity Identity of the file when its digest was started.  Nothing will be
+ *  written if the file has changed since.
+ *  @param digest Digest.
+ */
+void
+dcp::write_digest_cache (FileIdentity const & identity, string digest)
+{
+	optional<boost::filesystem::path> directory = digest_cache_directory ();
+	if (!directory) {
+		return;
+	}
+
+	try {
+		if (FileIdentity (identity.path()) != identity) {
+			return;
+		}
+	} catch (std::exception &) {
+		return;
+	}
+
+	write_cache (*directory, identity, "digest", "DigestCache", boost::bind (&write_digest, _1, digest));
+}
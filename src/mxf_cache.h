@@ -0,0 +1,82 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/mxf_cache.h
+ *  @brief Optional on-disk cache of details read from MXF headers and index tables.
+ *
+ *  Opening an MXF makes asdcplib parse its header, partitions and index table.  If
+ *  a cache directory is set, the details that libdcp needs from an MXF are stored there
+ *  after the first time it is read, and used in preference to parsing the MXF again for
+ *  as long as the MXF's FileIdentity (path, size, modification and change times, device
+ *  and inode) stays the same.
+ *
+ *  Similarly, if a digest cache directory is set, make_digest() stores the digests of the
+ *  files that it reads there, and uses them instead of reading the file again for as long as
+ *  the file's FileIdentity stays the same.  This is kept separate from the MXF cache since
+ *  it means that changes to a file which do not go through the filesystem (such as
+ *  corruption of the disk) will go unnoticed when verifying.
+ */
+
+#ifndef LIBDCP_MXF_CACHE_H
+#define LIBDCP_MXF_CACHE_H
+
+#include <libcxml/cxml.h>
+#include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+
+namespace xmlpp {
+	class Element;
+}
+
+namespace dcp {
+
+class FileIdentity;
+
+extern void set_mxf_cache_directory (boost::optional<boost::filesystem::path> directory);
+extern boost::optional<boost::filesystem::path> mxf_cache_directory ();
+
+extern boost::shared_ptr<cxml::Document> read_mxf_cache (boost::filesystem::path mxf, std::string part);
+extern void write_mxf_cache (boost::filesystem::path mxf, std::string part, boost::function<void (xmlpp::Element *)> fill);
+
+extern void set_digest_cache_directory (boost::optional<boost::filesystem::path> directory);
+extern boost::optional<boost::filesystem::path> digest_cache_directory ();
+
+extern boost::optional<std::string> read_digest_cache (boost::filesystem::path file);
+extern void write_digest_cache (FileIdentity const & identity, std::string digest);
+
+}
+
+#endif
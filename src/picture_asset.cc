@@ -39,6 +39,7 @@
 #include "dcp_assert.h"
 #include "compose.hpp"
 #include "j2k.h"
+#include "raw_convert.h"
 #include <asdcp/AS_DCP.h>
 #include <asdcp/KM_fileio.h>
 #include <libxml++/nodes/element.h>
@@ -83,6 +84,28 @@ PictureAsset::read_picture_descriptor (ASDCP::JP2K::PictureDescriptor const & de
 	_screen_aspect_ratio = Fraction (desc.AspectRatio.Numerator, desc.AspectRatio.Denominator);
 }
 
+void
+PictureAsset::read_cache_descriptor (cxml::ConstNodePtr node)
+{
+	_size.width = node->number_child<int> ("Width");
+	_size.height = node->number_child<int> ("Height");
+	_edit_rate = Fraction (node->string_child ("EditRate"));
+	_intrinsic_duration = node->number_child<int64_t> ("IntrinsicDuration");
+	_frame_rate = Fraction (node->string_child ("FrameRate"));
+	_screen_aspect_ratio = Fraction (node->string_child ("ScreenAspectRatio"));
+}
+
+void
+PictureAsset::write_cache_descriptor (xmlpp::Element* node) const
+{
+	node->add_child("Width")->add_child_text (raw_convert<string> (_size.width));
+	node->add_child("Height")->add_child_text (raw_convert<string> (_size.height));
+	node->add_child("EditRate")->add_child_text (_edit_rate.as_string ());
+	node->add_child("IntrinsicDuration")->add_child_text (raw_convert<string> (_intrinsic_duration));
+	node->add_child("FrameRate")->add_child_text (_frame_rate.as_string ());
+	node->add_child("ScreenAspectRatio")->add_child_text (_screen_aspect_ratio.as_string ());
+}
+
 bool
 PictureAsset::descriptor_equals (
 	ASDCP::JP2K::PictureDescriptor const & a, ASDCP::JP2K::PictureDescriptor const & b, NoteHandler note
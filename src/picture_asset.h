@@ -101,9 +101,13 @@ public:
 		return _intrinsic_duration;
 	}
 
+	/** @return the position and size of each frame's essence in our file, read from the MXF index table */
+	virtual std::vector<FrameIndexEntry> frame_index () const = 0;
+
 	static std::string static_pkl_type (Standard standard);
 
 protected:
+	friend class PictureAssetWriter;
 	friend class MonoPictureAssetWriter;
 	friend class StereoPictureAssetWriter;
 
@@ -119,6 +123,8 @@ protected:
 		) const;
 
 	void read_picture_descriptor (ASDCP::JP2K::PictureDescriptor const &);
+	void read_cache_descriptor (cxml::ConstNodePtr node);
+	void write_cache_descriptor (xmlpp::Element* node) const;
 
 	Fraction _edit_rate;
 	/** The total length of this content in video frames.  The amount of
@@ -34,19 +34,369 @@
 #include "picture_asset_writer.h"
 #include "exceptions.h"
 #include "picture_asset.h"
+#include "dcp_assert.h"
+#include "compose.hpp"
+#include "util.h"
 #include <asdcp/KM_fileio.h>
 #include <asdcp/AS_DCP.h>
+#include <openssl/evp.h>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <fstream>
+#include <algorithm>
+#include <cerrno>
 #include <inttypes.h>
 #include <stdint.h>
 
 using std::string;
+using std::vector;
 using boost::shared_ptr;
+using boost::function;
 using namespace dcp;
 
+/** First word of journal files */
+static string const journal_magic = "libdcp-journal-1";
+
 PictureAssetWriter::PictureAssetWriter (PictureAsset* asset, boost::filesystem::path file, bool overwrite)
 	: AssetWriter (asset, file)
 	, _picture_asset (asset)
 	, _overwrite (overwrite)
+	, _journal (0)
+	, _reorder_size (0)
+	, _reorder_limit (256 * 1024 * 1024)
+	, _reorder_next (0)
 {
 	asset->set_file (file);
 }
+
+PictureAssetWriter::~PictureAssetWriter ()
+{
+	if (_journal) {
+		fclose (_journal);
+	}
+}
+
+bool
+PictureAssetWriter::finalize ()
+{
+	if (_journal) {
+		fclose (_journal);
+		_journal = 0;
+	}
+
+	return AssetWriter::finalize ();
+}
+
+/** Write a frame, on the writer thread if this writer is asynchronous.  The data
+ *  are copied, so the caller can re-use them as soon as this method returns.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data.
+ *  @param done Function to be called with the FrameInfo once the frame has been written;
+ *  this will be called from the writer thread, and is called in the order that frames were given.
+ */
+void
+PictureAssetWriter::write_async (uint8_t const * data, int size, function<void (FrameInfo)> done)
+{
+	if (!_writer_thread) {
+		write_and_notify (data, size, done);
+		return;
+	}
+
+	write_async (Data (data, size), done);
+}
+
+/** Write a frame, on the writer thread if this writer is asynchronous.  The frame is
+ *  not copied; the writer keeps a reference to it until it has been written.
+ *  @param data JPEG2000 data, which must not be modified until done is called.
+ *  @param done Function to be called with the FrameInfo once the frame has been written.
+ */
+void
+PictureAssetWriter::write_async (Data data, function<void (FrameInfo)> done)
+{
+	queue (boost::bind (&PictureAssetWriter::write_queued, this, data, done));
+}
+
+void
+PictureAssetWriter::write_queued (Data data, function<void (FrameInfo)> done)
+{
+	write_and_notify (data.data().get(), data.size(), done);
+}
+
+void
+PictureAssetWriter::write_and_notify (uint8_t const * data, int size, function<void (FrameInfo)> done)
+{
+	FrameInfo const info = write (data, size);
+	if (done) {
+		done (info);
+	}
+}
+
+/** Write a frame which may be out of order.  This can be called from several threads at once.
+ *  If the frame is the next one to be written it is written (along with any following frames that
+ *  have already arrived) by the calling thread; otherwise a copy is kept until its turn comes.
+ *  If more than the reorder limit is already being held, this will block until some of it is
+ *  written, unless this is the next frame.
+ *
+ *  @param index Index of the frame, counting from 0.  For stereoscopic assets, 2n is the
+ *  left eye of frame n and 2n + 1 is its right eye.
+ *  @param data JPEG2000 data.
+ *  @param size Size of data.
+ *  @param done Function to be called with the FrameInfo once the frame has been written;
+ *  this may be called from any thread which is calling write(), or from the writer thread.
+ */
+void
+PictureAssetWriter::write (int64_t index, uint8_t const * data, int size, function<void (FrameInfo)> done)
+{
+	boost::mutex::scoped_lock lm (_reorder_mutex);
+
+	DCP_ASSERT (index >= _reorder_next);
+	DCP_ASSERT (_reorder_buffer.find (index) == _reorder_buffer.end ());
+
+	if (index != _reorder_next) {
+		while (!_reorder_buffer.empty() && _reorder_size + size > _reorder_limit && index != _reorder_next) {
+			_reorder_condition.wait (lm);
+		}
+	}
+
+	if (index != _reorder_next) {
+		PendingFrame pending;
+		pending.data = Data (data, size);
+		pending.done = done;
+		_reorder_buffer[index] = pending;
+		_reorder_size += size;
+		return;
+	}
+
+	/* This is the next frame, so only this thread can be writing; other threads will add
+	   their frames to _reorder_buffer while we are working.
+	*/
+
+	lm.unlock ();
+	write_async (data, size, done);
+	lm.lock ();
+	++_reorder_next;
+
+	while (true) {
+		std::map<int64_t, PendingFrame>::iterator i = _reorder_buffer.find (_reorder_next);
+		if (i == _reorder_buffer.end ()) {
+			break;
+		}
+
+		PendingFrame next = i->second;
+		_reorder_buffer.erase (i);
+		_reorder_size -= next.data.size ();
+
+		lm.unlock ();
+		write_async (next.data, next.done);
+		lm.lock ();
+		++_reorder_next;
+		_reorder_condition.notify_all ();
+	}
+
+	_reorder_condition.notify_all ();
+}
+
+/** Throw an exception if any out-of-order frames are still waiting for a missing frame */
+void
+PictureAssetWriter::check_reorder_buffer ()
+{
+	boost::mutex::scoped_lock lm (_reorder_mutex);
+	if (!_reorder_buffer.empty ()) {
+		boost::throw_exception (
+			MiscError (String::compose ("frame %1 was never written, so %2 later frames could not be written", _reorder_next, _reorder_buffer.size()))
+			);
+	}
+}
+
+/** Record the FrameInfo of each frame that is written in a journal file, so that writing
+ *  can be resumed after a crash.  Must be called before anything is written.
+ *  @param journal Journal file, which will be overwritten if it exists.
+ */
+void
+PictureAssetWriter::set_journal (boost::filesystem::path journal)
+{
+	DCP_ASSERT (!_started);
+	open_journal (journal, vector<FrameInfo> ());
+}
+
+void
+PictureAssetWriter::open_journal (boost::filesystem::path journal, vector<FrameInfo> const & frames)
+{
+	if (_journal) {
+		fclose (_journal);
+	}
+
+	_journal = fopen_boost (journal, "w");
+	if (!_journal) {
+		boost::throw_exception (FileError ("could not open journal for writing", journal, errno));
+	}
+
+	fprintf (
+		_journal, "%s %s %s %s\n",
+		journal_magic.c_str(),
+		_picture_asset->id().c_str(),
+		_picture_asset->key_id().get_value_or("none").c_str(),
+		_picture_asset->context_id().c_str()
+		);
+
+	BOOST_FOREACH (FrameInfo const & i, frames) {
+		add_to_journal (i);
+	}
+
+	fflush (_journal);
+}
+
+/** Add a frame to our journal, if we have one */
+void
+PictureAssetWriter::add_to_journal (FrameInfo const & info)
+{
+	if (!_journal) {
+		return;
+	}
+
+	fprintf (_journal, "%" PRIu64 " %" PRIu64 " %s\n", info.offset, info.size, info.hash.c_str());
+	fflush (_journal);
+}
+
+/** @return true if the data at info's position in the file have the hash that it gives */
+static bool
+frame_matches (Kumu::FileReader& reader, FrameInfo const & info)
+{
+	if (ASDCP_FAILURE (reader.Seek (info.offset))) {
+		return false;
+	}
+
+#if OPENSSL_VERSION_NUMBER > 0x10100000L
+	EVP_MD_CTX* md5 = EVP_MD_CTX_new ();
+#else
+	EVP_MD_CTX* md5 = EVP_MD_CTX_create ();
+#endif
+	if (!md5) {
+		return false;
+	}
+
+	bool ok = EVP_DigestInit_ex (md5, EVP_md5(), 0) == 1;
+
+	Kumu::ByteString buffer (65536);
+	uint64_t remaining = info.size;
+	while (ok && remaining > 0) {
+		ui32_t const want = std::min (remaining, static_cast<uint64_t> (buffer.Capacity()));
+		ui32_t read = 0;
+		if (ASDCP_FAILURE (reader.Read (buffer.Data(), want, &read)) || read != want) {
+			ok = false;
+			break;
+		}
+		ok = EVP_DigestUpdate (md5, buffer.Data(), read) == 1;
+		remaining -= read;
+	}
+
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int length = 0;
+	ok = ok && EVP_DigestFinal_ex (md5, digest, &length) == 1;
+
+#if OPENSSL_VERSION_NUMBER > 0x10100000L
+	EVP_MD_CTX_free (md5);
+#else
+	EVP_MD_CTX_destroy (md5);
+#endif
+
+	if (!ok) {
+		return false;
+	}
+
+	char hex[EVP_MAX_MD_SIZE * 2 + 1];
+	for (unsigned int i = 0; i < length; ++i) {
+		snprintf (hex + i * 2, 3, "%02x", digest[i]);
+	}
+
+	return info.hash == hex;
+}
+
+/** Prepare to carry on writing an MXF whose writing was interrupted, using the journal
+ *  that the earlier writer was given with set_journal().  The frames in the journal are checked
+ *  against the MXF, which is then truncated after the last one that is intact.  The next frame given
+ *  to write() will follow that one, and the journal will be continued.
+ *
+ *  The asset takes its ID and encryption context ID from the journal.  If the interrupted
+ *  asset was encrypted, the same key and key ID must be set on this writer's asset first.
+ *
+ *  Must be called before anything is written.
+ *
+ *  @param journal Journal file.
+ *  @return Number of frames that were recovered; for stereoscopic assets each eye counts as a frame.
+ */
+int64_t
+PictureAssetWriter::resume (boost::filesystem::path journal)
+{
+	DCP_ASSERT (!_started);
+
+	std::ifstream in (journal.string().c_str ());
+	if (!in.good ()) {
+		boost::throw_exception (FileError ("could not open journal", journal, errno));
+	}
+
+	string magic;
+	string id;
+	string key_id;
+	string context_id;
+	in >> magic >> id >> key_id >> context_id;
+	if (in.fail () || magic != journal_magic) {
+		boost::throw_exception (MiscError (String::compose ("%1 is not a valid journal", journal.string())));
+	}
+
+	if (key_id != _picture_asset->key_id().get_value_or("none")) {
+		boost::throw_exception (MiscError ("journal was written for an asset with a different key ID"));
+	}
+
+	vector<FrameInfo> good;
+
+	Kumu::FileReader reader;
+	if (ASDCP_SUCCESS (reader.OpenRead (_file.string().c_str ()))) {
+		while (true) {
+			FrameInfo info;
+			in >> info.offset >> info.size >> info.hash;
+			if (in.fail ()) {
+				/* End of the journal, or a line that was only partly written */
+				break;
+			}
+			if (!good.empty() && info.offset != good.back().offset + good.back().size) {
+				break;
+			}
+			if (!frame_matches (reader, info)) {
+				break;
+			}
+			good.push_back (info);
+		}
+		reader.Close ();
+	}
+
+	_picture_asset->_id = id;
+	_picture_asset->set_context_id (context_id);
+
+	if (good.empty ()) {
+		/* There's nothing worth keeping, so start again */
+		_overwrite = false;
+	} else {
+		boost::filesystem::resize_file (_file, good.back().offset + good.back().size);
+		_overwrite = true;
+	}
+
+	_resumed_frames = good;
+	_reorder_next = good.size ();
+	open_journal (journal, good);
+
+	return good.size ();
+}
+
+/** Called by subclasses once they have started writing, to step over the frames that
+ *  resume() kept.
+ */
+void
+PictureAssetWriter::skip_resumed_frames ()
+{
+	vector<FrameInfo> frames;
+	frames.swap (_resumed_frames);
+	BOOST_FOREACH (FrameInfo const & i, frames) {
+		fake_write (i.size);
+	}
+}
@@ -41,10 +41,17 @@
 #include "metadata.h"
 #include "types.h"
 #include "asset_writer.h"
+#include "data.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <stdint.h>
+#include <cstdio>
 #include <string>
+#include <vector>
+#include <map>
 
 namespace dcp {
 
@@ -73,12 +80,40 @@ struct FrameInfo
 
 /** @class PictureAssetWriter
  *  @brief Parent class for classes which write picture assets.
+ *
+ *  When the writer is asynchronous (see AssetWriter::set_asynchronous) frames must be
+ *  written with write_async(); write() and fake_write() must not be mixed with it.
+ *
+ *  Frames may also be given out of order, from any thread, using the variant of write()
+ *  which takes a frame index.  These frames are held in memory until the frames before
+ *  them have arrived.  Again, this must not be mixed with the other ways of writing.
+ *
+ *  If set_journal() is called, the FrameInfo of each frame is recorded in a file as it is
+ *  written, so that a writer created after a crash can call resume() to keep the frames
+ *  which were safely written and carry on from there.
  */
 class PictureAssetWriter : public AssetWriter
 {
 public:
+	virtual ~PictureAssetWriter ();
+
 	virtual FrameInfo write (uint8_t const *, int) = 0;
 	virtual void fake_write (int) = 0;
+	bool finalize ();
+
+	void set_journal (boost::filesystem::path journal);
+	int64_t resume (boost::filesystem::path journal);
+
+	void write_async (uint8_t const * data, int size, boost::function<void (FrameInfo)> done);
+	void write_async (Data data, boost::function<void (FrameInfo)> done);
+	void write (int64_t index, uint8_t const * data, int size, boost::function<void (FrameInfo)> done = boost::function<void (FrameInfo)> ());
+
+	/** Set the maximum number of bytes of out-of-order frames that can be held
+	 *  before further out-of-order writes block.
+	 */
+	void set_reorder_limit (int64_t bytes) {
+		_reorder_limit = bytes;
+	}
 
 protected:
 	template <class P, class Q>
@@ -86,8 +121,41 @@ protected:
 
 	PictureAssetWriter (PictureAsset *, boost::filesystem::path, bool);
 
+	void write_queued (Data data, boost::function<void (FrameInfo)> done);
+	void write_and_notify (uint8_t const * data, int size, boost::function<void (FrameInfo)> done);
+	void check_reorder_buffer ();
+	void add_to_journal (FrameInfo const & info);
+	void skip_resumed_frames ();
+
 	PictureAsset* _picture_asset;
 	bool _overwrite;
+
+private:
+	void open_journal (boost::filesystem::path journal, std::vector<FrameInfo> const & frames);
+
+	/** journal that we are writing to, or 0 */
+	FILE* _journal;
+	/** frames that resume() found in an existing file, which must be skipped over
+	 *  by fake_write() once we have started.
+	 */
+	std::vector<FrameInfo> _resumed_frames;
+
+	struct PendingFrame
+	{
+		Data data;
+		boost::function<void (FrameInfo)> done;
+	};
+
+	/** mutex to protect _reorder_buffer, _reorder_size and _reorder_next */
+	boost::mutex _reorder_mutex;
+	boost::condition_variable _reorder_condition;
+	/** frames which have been given to write() with an index, but can't be written yet */
+	std::map<int64_t, PendingFrame> _reorder_buffer;
+	/** total size of the data in _reorder_buffer in bytes */
+	int64_t _reorder_size;
+	int64_t _reorder_limit;
+	/** index of the next frame to be written */
+	int64_t _reorder_next;
 };
 
 }
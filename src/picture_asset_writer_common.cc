@@ -43,12 +43,77 @@ struct ASDCPStateBase
 
 	ASDCP::JP2K::CodestreamParser j2k_parser;
 	ASDCP::JP2K::FrameBuffer frame_buffer;
+	/** buffer for just the headers of frames which are written without being copied */
+	ASDCP::JP2K::FrameBuffer header_buffer;
+	/** buffer which points at the caller's data for frames which are written without being copied */
+	ASDCP::JP2K::FrameBuffer borrowed_buffer;
 	ASDCP::WriterInfo writer_info;
 	ASDCP::JP2K::PictureDescriptor picture_descriptor;
 };
 
 }
 
+/** @return Length of the start of a J2K codestream up to and including its first SOD marker,
+ *  or 0 if no SOD marker could be found.
+ */
+static int
+j2k_header_length (uint8_t const * data, int size)
+{
+	int p = 0;
+	while (p + 2 <= size) {
+		if (data[p] != 0xff) {
+			return 0;
+		}
+
+		uint8_t const marker = data[p + 1];
+		p += 2;
+
+		if (marker == 0x93) {
+			/* SOD */
+			return p;
+		} else if (marker == 0x4f || (marker >= 0x30 && marker <= 0x3f)) {
+			/* SOC and the reserved markers have no segment */
+			continue;
+		}
+
+		if (p + 2 > size) {
+			return 0;
+		}
+
+		p += (data[p] << 8) | data[p + 1];
+	}
+
+	return 0;
+}
+
+/** Get a J2K frame ready to be written.  Only the codestream headers are given to asdcplib's
+ *  parser (so that it still decides on the plaintext offset for encryption); the frame itself
+ *  is written from the caller's data without copying it, if possible.
+ *  @return Buffer to write, which is valid until the next call or until data is changed.
+ */
+static ASDCP::JP2K::FrameBuffer const &
+prepare_frame (dcp::ASDCPStateBase* state, uint8_t const * data, int size)
+{
+	int const header = j2k_header_length (data, size);
+	if (header == 0) {
+		/* Let asdcplib make what it can of the whole thing */
+		if (ASDCP_FAILURE (state->j2k_parser.OpenReadFrame (data, size, state->frame_buffer))) {
+			boost::throw_exception (dcp::MiscError ("could not parse J2K frame"));
+		}
+		return state->frame_buffer;
+	}
+
+	if (ASDCP_FAILURE (state->j2k_parser.OpenReadFrame (data, header, state->header_buffer))) {
+		boost::throw_exception (dcp::MiscError ("could not parse J2K frame"));
+	}
+
+	/* WriteFrame only reads from the buffer, even when encrypting */
+	state->borrowed_buffer.SetData (const_cast<uint8_t*> (data), size);
+	state->borrowed_buffer.Size (size);
+	state->borrowed_buffer.PlaintextOffset (state->header_buffer.PlaintextOffset ());
+	return state->borrowed_buffer;
+}
+
 template <class P, class Q>
 void dcp::start (PictureAssetWriter* writer, shared_ptr<P> state, Q* asset, uint8_t const * data, int size)
 {
@@ -78,5 +143,6 @@ void dcp::start (PictureAssetWriter* writer, shared_ptr<P> state, Q* asset, uint
 		boost::throw_exception (MXFFileError ("could not open MXF file for writing", asset->file()->string(), r));
 	}
 
+	writer->preallocate ();
 	writer->_started = true;
 }
@@ -0,0 +1,504 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/picture_frame_checker.cc
+ *  @brief PictureFrameChecker and PictureFrameSampler classes.
+ */
+
+#include "picture_frame_checker.h"
+#include "j2k.h"
+#include "exceptions.h"
+#include "compose.hpp"
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/foreach.hpp>
+#include <cmath>
+
+using std::map;
+using std::list;
+using std::set;
+using std::string;
+using std::min;
+using std::max;
+using namespace dcp;
+
+/** DCI maximum bit rate for a picture, in bits per second */
+static int64_t const max_bit_rate = 250000000;
+
+/** @param file Picture asset file, for notes.
+ *  @param edit_rate Edit rate of the asset.
+ *  @param stereo true if the asset is stereoscopic, so that each frame has two codestreams.
+ *  @param encrypted true if the asset is encrypted, in which case only the sizes of frames (as given
+ *  in their encrypted triplets) are checked.
+ */
+PictureFrameChecker::PictureFrameChecker (boost::filesystem::path file, Fraction edit_rate, bool stereo, bool encrypted)
+	: _file (file)
+	, _stereo (stereo)
+	, _encrypted (encrypted)
+	, _max_size (max_bit_rate * edit_rate.denominator / (8 * int64_t (edit_rate.numerator) * (stereo ? 2 : 1)))
+{
+
+}
+
+/** Read a BER-encoded length.
+ *  @param data Encoded length.
+ *  @param size Number of bytes available at data.
+ *  @param length Filled in with the length.
+ *  @return Number of bytes used by the encoded length, or -1 if it does not fit in size.
+ */
+static int
+ber_length (uint8_t const * data, int64_t size, int64_t* length)
+{
+	if (size < 1) {
+		return -1;
+	}
+
+	if (data[0] < 0x80) {
+		*length = data[0];
+		return 1;
+	}
+
+	int const bytes = data[0] & 0x7f;
+	if (bytes == 0 || bytes > 8 || size < 1 + bytes) {
+		return -1;
+	}
+	*length = 0;
+	for (int i = 0; i < bytes; ++i) {
+		*length = (*length << 8) | data[1 + i];
+	}
+	return 1 + bytes;
+}
+
+/** Find the value of a KLV packet.
+ *  @param data Packet.
+ *  @param size Number of bytes available at data.
+ *  @param length Filled in with the length of the value.
+ *  @return Offset of the value from data, or -1 if the packet does not fit in size.
+ */
+static int64_t
+klv_value (uint8_t const * data, int64_t size, int64_t* length)
+{
+	/* 16-byte key, then a BER-encoded length */
+	if (size < 16) {
+		return -1;
+	}
+
+	int const bytes = ber_length (data + 16, size - 16, length);
+	if (bytes == -1) {
+		return -1;
+	}
+
+	int64_t const header = 16 + bytes;
+	if (*length < 0 || *length > size - header) {
+		return -1;
+	}
+
+	return header;
+}
+
+/** Find the size of the plaintext of an encrypted triplet (SMPTE 429-6), which is given
+ *  by the triplet's SourceLength item.
+ *  @param data Value of the triplet's KLV packet.
+ *  @param size Size of data in bytes.
+ *  @return Size of the plaintext in bytes, or -1 if the triplet could not be read.
+ */
+static int64_t
+encrypted_source_length (uint8_t const * data, int64_t size)
+{
+	/* ContextID, PlaintextOffset and SourceKey, then SourceLength, each with a BER-encoded length */
+	for (int i = 0; i < 4; ++i) {
+		int64_t length = 0;
+		int const bytes = ber_length (data, size, &length);
+		if (bytes == -1 || length < 0 || length > size - bytes) {
+			return -1;
+		}
+
+		if (i == 3) {
+			if (length != 8 || data[bytes] >= 0x80) {
+				return -1;
+			}
+			int64_t source = 0;
+			for (int j = 0; j < 8; ++j) {
+				source = (source << 8) | data[bytes + j];
+			}
+			return source;
+		}
+
+		data += bytes + length;
+		size -= bytes + length;
+	}
+
+	return -1;
+}
+
+static int
+get_16 (uint8_t const * p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static int64_t
+get_32 (uint8_t const * p)
+{
+	return (int64_t (p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/** Find the COD marker segment in the main header of a JPEG2000 codestream.
+ *  @param data Codestream, starting with SOC.
+ *  @param size Size of data in bytes.
+ *  @return Pointer to the segment's parameters (after Lcod), which are Scod, progression order,
+ *  layers (2 bytes), MCT and then decomposition levels; or 0 if there is no complete COD.
+ */
+static uint8_t const *
+find_cod (uint8_t const * data, int64_t size)
+{
+	/* Look through the markers of the main header, starting with SIZ */
+	int64_t position = 2;
+	while (position + 4 <= size) {
+		int const marker = get_16 (data + position);
+		int const length = get_16 (data + position + 2);
+		if ((marker & 0xff00) != 0xff00 || marker == 0xff90 || length < 2) {
+			/* Not a marker, or the start of the first tile, so there is no COD */
+			return 0;
+		}
+
+		if (marker == 0xff52) {
+			if (length < 12 || position + 2 + length > size) {
+				return 0;
+			}
+			return data + position + 4;
+		}
+
+		position += 2 + length;
+	}
+
+	return 0;
+}
+
+/** Check one frame.
+ *  @param frame Index of the frame within the asset.
+ *  @param data The frame's KLV packet(s): one for a 2D frame, or left then right for a 3D one.
+ *  @param size Size of data in bytes.
+ */
+void
+PictureFrameChecker::check (int64_t frame, uint8_t const * data, int64_t size)
+{
+	for (int eye = 0; eye < (_stereo ? 2 : 1); ++eye) {
+		int64_t length = 0;
+		int64_t const value = klv_value (data, size, &length);
+		if (value == -1) {
+			problem (VerificationNote::INVALID_JPEG2000_CODESTREAM, frame);
+			return;
+		}
+
+		if (_encrypted) {
+			/* The packet's value includes the encryption overhead, so the limit applies
+			   to the size of the plaintext codestream that the triplet records.
+			*/
+			int64_t const source = encrypted_source_length (data + value, length);
+			if (source == -1) {
+				problem (VerificationNote::INVALID_JPEG2000_CODESTREAM, frame);
+			} else if (source > _max_size) {
+				problem (VerificationNote::PICTURE_FRAME_TOO_LARGE, frame);
+			}
+		} else {
+			if (length > _max_size) {
+				problem (VerificationNote::PICTURE_FRAME_TOO_LARGE, frame);
+			}
+			check_codestream (frame, data + value, length);
+		}
+
+		data += value + length;
+		size -= value + length;
+	}
+}
+
+/** Check the main header of a JPEG2000 codestream */
+void
+PictureFrameChecker::check_codestream (int64_t frame, uint8_t const * data, int64_t size)
+{
+	/* SOC then SIZ, which is at least 41 bytes for one component */
+	if (size < 4 + 41 || get_16 (data) != 0xff4f || get_16 (data + 2) != 0xff51) {
+		problem (VerificationNote::INVALID_JPEG2000_CODESTREAM, frame);
+		return;
+	}
+
+	uint8_t const * siz = data + 4;
+	int const rsiz = get_16 (siz + 2);
+	int64_t const width = get_32 (siz + 4) - get_32 (siz + 12);
+	int64_t const height = get_32 (siz + 8) - get_32 (siz + 16);
+
+	/* Rsiz is 3 for the DCI 2K profile and 4 for 4K */
+	bool const four_k = rsiz == 4;
+	if ((rsiz != 3 && rsiz != 4) || width > (four_k ? 4096 : 2048) || height > (four_k ? 2160 : 1080)) {
+		problem (VerificationNote::INVALID_JPEG2000_PROFILE, frame);
+	}
+
+	uint8_t const * cod = find_cod (data, size);
+	if (!cod) {
+		problem (VerificationNote::INVALID_JPEG2000_CODESTREAM, frame);
+		return;
+	}
+
+	if (cod[1] != 4) {
+		/* 4 is CPRL */
+		problem (VerificationNote::INVALID_JPEG2000_PROGRESSION_ORDER, frame);
+	}
+
+	int const levels = cod[5];
+	if (levels < 1 || levels > (four_k ? 6 : 5)) {
+		problem (VerificationNote::INVALID_JPEG2000_RESOLUTION_LEVELS, frame);
+	}
+}
+
+void
+PictureFrameChecker::problem (VerificationNote::Code code, int64_t frame)
+{
+	Problem& p = _problems[code];
+	if (p.frames == 0) {
+		p.first = frame;
+	}
+	++p.frames;
+}
+
+/** @return Problems found with the frames that have been checked, one for each type of problem */
+list<VerificationNote>
+PictureFrameChecker::notes () const
+{
+	list<VerificationNote> n;
+	for (map<VerificationNote::Code, Problem>::const_iterator i = _problems.begin(); i != _problems.end(); ++i) {
+		n.push_back (
+			VerificationNote (
+				VerificationNote::VERIFY_ERROR,
+				i->first,
+				String::compose ("%1 frame(s), the first being frame %2", i->second.frames, i->second.first),
+				_file
+				)
+			);
+	}
+	return n;
+}
+
+/** @param file Picture asset file, for notes.
+ *  @param id ID of the asset, which is used with seed to choose the sample.
+ *  @param frames Number of frames in the asset.
+ *  @param stereo true if the asset is stereoscopic, so that each frame has two codestreams.
+ *  @param fraction Fraction of the frames to decode, from 0 to 1; at least one frame will be decoded.
+ *  @param boundaries Frames to decode as well as the sample; the first and last frames of the
+ *  asset are always decoded.
+ *  @param seed Seed for the choice of frames.
+ */
+PictureFrameSampler::PictureFrameSampler (
+	boost::filesystem::path file,
+	string id,
+	int64_t frames,
+	bool stereo,
+	float fraction,
+	set<int64_t> boundaries,
+	uint32_t seed
+	)
+	: _file (file)
+	, _frames (frames)
+	, _stereo (stereo)
+	, _decoded (0)
+	, _failed (0)
+	, _first_failed (0)
+	, _unreached (0)
+	, _first_unreached (0)
+{
+	if (_frames <= 0) {
+		return;
+	}
+
+	/* Mix the asset's ID into the seed (FNV-1a) so that each asset gets a different sample */
+	uint32_t hash = 2166136261U;
+	BOOST_FOREACH (char i, id) {
+		hash = (hash ^ static_cast<uint8_t> (i)) * 16777619U;
+	}
+	boost::random::mt19937 rng (seed ^ hash);
+
+	int64_t const strata = min (_frames, max (int64_t (1), int64_t (ceil (fraction * _frames))));
+	for (int64_t i = 0; i < strata; ++i) {
+		int64_t const start = i * _frames / strata;
+		int64_t const end = (i + 1) * _frames / strata;
+		_sample.insert (start + rng() % (end - start));
+	}
+
+	_sample.insert (0);
+	_sample.insert (_frames - 1);
+	BOOST_FOREACH (int64_t i, boundaries) {
+		if (i >= 0 && i < _frames) {
+			_sample.insert (i);
+		}
+	}
+}
+
+/** Decode a frame, if it is in the sample.
+ *  @param frame Index of the frame within the asset.
+ *  @param data The frame's KLV packet(s): one for a 2D frame, or left then right for a 3D one.
+ *  @param size Size of data in bytes.
+ */
+void
+PictureFrameSampler::check (int64_t frame, uint8_t const * data, int64_t size)
+{
+	if (_sample.find (frame) == _sample.end()) {
+		return;
+	}
+
+	bool ok = true;
+	for (int eye = 0; eye < (_stereo ? 2 : 1); ++eye) {
+		int64_t length = 0;
+		int64_t const value = klv_value (data, size, &length);
+		if (value == -1 || !decode (data + value, length)) {
+			ok = false;
+			break;
+		}
+
+		data += value + length;
+		size -= value + length;
+	}
+
+	if (!ok) {
+		if (_failed == 0) {
+			_first_failed = frame;
+		}
+		++_failed;
+	}
+
+	++_decoded;
+}
+
+/** Note that check() was never called for some frames, for example because the MXF's index
+ *  does not cover them or the file ends before them.  Any of them which are in the sample
+ *  are reported as errors.
+ *  @param from Index of the first frame which was not given to check(); every frame after
+ *  it must also have been missed.
+ */
+void
+PictureFrameSampler::not_reached (int64_t from)
+{
+	for (set<int64_t>::const_iterator i = _sample.lower_bound (from); i != _sample.end(); ++i) {
+		if (_unreached == 0) {
+			_first_unreached = *i;
+		}
+		++_unreached;
+	}
+}
+
+/** Decode a JPEG2000 codestream at its lowest resolution.
+ *  @return true if it was decoded successfully.
+ */
+bool
+PictureFrameSampler::decode (uint8_t const * data, int64_t size) const
+{
+	uint8_t const * cod = find_cod (data, size);
+	if (!cod) {
+		return false;
+	}
+
+	try {
+		/* decompress_j2k does not write to the data it is given */
+		decompress_j2k (const_cast<uint8_t*> (data), size, cod[5]);
+	} catch (DCPReadError &) {
+		return false;
+	} catch (MiscError &) {
+		return false;
+	}
+
+	return true;
+}
+
+/** @return Notes of the frames which could not be decoded or were not reached, if there were
+ *  any; otherwise a note of how many frames were decoded and the confidence that this gives.
+ */
+list<VerificationNote>
+PictureFrameSampler::notes () const
+{
+	list<VerificationNote> n;
+
+	if (_failed > 0) {
+		n.push_back (
+			VerificationNote (
+				VerificationNote::VERIFY_ERROR,
+				VerificationNote::PICTURE_FRAME_DECODE_FAILED,
+				String::compose ("%1 of %2 sampled frame(s), the first being frame %3", _failed, _decoded, _first_failed),
+				_file
+				)
+			);
+	}
+
+	if (_unreached > 0) {
+		n.push_back (
+			VerificationNote (
+				VerificationNote::VERIFY_ERROR,
+				VerificationNote::PICTURE_FRAME_DECODE_FAILED,
+				String::compose ("%1 sampled frame(s) could not be found in the file, the first being frame %2", _unreached, _first_unreached),
+				_file
+				)
+			);
+	}
+
+	if (!n.empty ()) {
+		/* There is no confidence to claim */
+		return n;
+	}
+
+	if (_decoded >= _frames) {
+		n.push_back (
+			VerificationNote (
+				VerificationNote::VERIFY_INFO,
+				VerificationNote::PICTURE_FRAMES_SAMPLED,
+				String::compose ("all %1 frames decoded", _frames),
+				_file
+				)
+			);
+	} else if (_decoded > 0) {
+		/* If a proportion p of frames could not be decoded, the chance of decoding _decoded
+		   (roughly independent) frames successfully is (1 - p)^_decoded; find the p for which
+		   that is 5%.
+		*/
+		double const bound = 1 - pow (0.05, 1.0 / _decoded);
+		n.push_back (
+			VerificationNote (
+				VerificationNote::VERIFY_INFO,
+				VerificationNote::PICTURE_FRAMES_SAMPLED,
+				String::compose (
+					"%1 of %2 frames decoded; with 95%% confidence fewer than %3%% of frames cannot be decoded",
+					_decoded, _frames, ceil (bound * 1000) / 10
+					),
+				_file
+				)
+			);
+	}
+
+	return n;
+}
@@ -0,0 +1,145 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/picture_frame_checker.h
+ *  @brief PictureFrameChecker and PictureFrameSampler classes.
+ */
+
+#ifndef LIBDCP_PICTURE_FRAME_CHECKER_H
+#define LIBDCP_PICTURE_FRAME_CHECKER_H
+
+#include "verify.h"
+#include "types.h"
+#include <boost/filesystem.hpp>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <stdint.h>
+
+namespace dcp {
+
+/** @class PictureFrameChecker
+ *  @brief Checker of the size and JPEG2000 codestream header of each frame of a picture asset
+ *  against the DCI specification.
+ *
+ *  Frames are not decoded; only the codestream's main header (as far as its COD marker) is read.
+ *  Each problem is reported once per asset, with the number of frames that have it.
+ */
+class PictureFrameChecker
+{
+public:
+	PictureFrameChecker (boost::filesystem::path file, Fraction edit_rate, bool stereo, bool encrypted);
+
+	void check (int64_t frame, uint8_t const * data, int64_t size);
+	std::list<VerificationNote> notes () const;
+
+private:
+	void check_codestream (int64_t frame, uint8_t const * data, int64_t size);
+	void problem (VerificationNote::Code code, int64_t frame);
+
+	boost::filesystem::path _file;
+	bool _stereo;
+	bool _encrypted;
+	/** largest allowed size of the codestream of a frame (or of each eye) in bytes */
+	int64_t _max_size;
+
+	struct Problem
+	{
+		Problem ()
+			: frames (0)
+			, first (0)
+		{}
+
+		/** number of frames with the problem */
+		int64_t frames;
+		/** index of the first frame with the problem */
+		int64_t first;
+	};
+
+	std::map<VerificationNote::Code, Problem> _problems;
+};
+
+/** @class PictureFrameSampler
+ *  @brief Decoder of a sample of the frames of a picture asset, to give some confidence that
+ *  the asset's frames can be decoded without the time taken to decode them all.
+ *
+ *  The sample is stratified, with one frame chosen at random from each of a set of equal-sized
+ *  runs of frames, and always includes some given frames (such as those at reel boundaries).
+ *  Frames are decoded at their lowest resolution.  The choice of frames depends only on the
+ *  seed and the asset's ID, so that the same asset is always sampled in the same way.
+ */
+class PictureFrameSampler
+{
+public:
+	PictureFrameSampler (
+		boost::filesystem::path file,
+		std::string id,
+		int64_t frames,
+		bool stereo,
+		float fraction,
+		std::set<int64_t> boundaries,
+		uint32_t seed
+		);
+
+	void check (int64_t frame, uint8_t const * data, int64_t size);
+	void not_reached (int64_t from);
+	std::list<VerificationNote> notes () const;
+
+	/** @return the frames that will be decoded */
+	std::set<int64_t> const & sample () const {
+		return _sample;
+	}
+
+private:
+	bool decode (uint8_t const * data, int64_t size) const;
+
+	boost::filesystem::path _file;
+	int64_t _frames;
+	bool _stereo;
+	std::set<int64_t> _sample;
+	/** number of frames in the sample which have been decoded, successfully or not */
+	int64_t _decoded;
+	/** number of frames which could not be decoded */
+	int64_t _failed;
+	/** index of the first frame which could not be decoded */
+	int64_t _first_failed;
+	/** number of frames in the sample which were never given to check() */
+	int64_t _unreached;
+	/** index of the first frame in the sample which was never given to check() */
+	int64_t _first_unreached;
+};
+
+}
+
+#endif
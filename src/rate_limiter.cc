@@ -0,0 +1,115 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/rate_limiter.cc
+ *  @brief RateLimiter class.
+ */
+
+#include "rate_limiter.h"
+#include "util.h"
+#include <algorithm>
+
+using std::min;
+using std::max;
+using namespace dcp;
+
+/** @param bytes_per_second Rate to limit to, or 0 for no limit */
+RateLimiter::RateLimiter (double bytes_per_second)
+	: _rate (max (bytes_per_second, 0.0))
+	, _taken (0)
+	, _allowed (0)
+	, _last (monotonic_microseconds ())
+{
+
+}
+
+/** Change the rate; readers which are already waiting will be woken to use the new rate.
+ *  @param bytes_per_second New rate, or 0 for no limit.
+ */
+void
+RateLimiter::set_rate (double bytes_per_second)
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		refill ();
+		_rate = max (bytes_per_second, 0.0);
+	}
+
+	_condition.notify_all ();
+}
+
+/** @return rate in bytes per second, or 0 if there is no limit */
+double
+RateLimiter::rate () const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	return _rate;
+}
+
+/** Add the tokens which have arrived since the last call.  _mutex must be held */
+void
+RateLimiter::refill ()
+{
+	int64_t const t = monotonic_microseconds ();
+
+	if (_rate == 0) {
+		/* No limit, so everything that has been asked for is allowed */
+		_allowed = _taken;
+	} else {
+		_allowed += (t - _last) * _rate / 1e6;
+		/* Don't let an idle bucket fill up by more than our burst */
+		_allowed = min (_allowed, _taken + _rate / 4);
+	}
+
+	_last = t;
+}
+
+/** Take some bytes from the bucket, blocking until they are available.
+ *  Bytes are handed out in the order that they are asked for.
+ *  @param bytes Number of bytes.
+ */
+void
+RateLimiter::take (int64_t bytes)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	refill ();
+	_taken += bytes;
+	double const mark = _taken;
+
+	while (_rate > 0 && _allowed < mark) {
+		int64_t const wait = static_cast<int64_t> ((mark - _allowed) * 1e6 / _rate) + 1;
+		_condition.timed_wait (lm, boost::posix_time::microseconds (wait));
+		refill ();
+	}
+}
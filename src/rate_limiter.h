@@ -0,0 +1,84 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/rate_limiter.h
+ *  @brief RateLimiter class.
+ */
+
+#ifndef LIBDCP_RATE_LIMITER_H
+#define LIBDCP_RATE_LIMITER_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <stdint.h>
+
+namespace dcp {
+
+/** @class RateLimiter
+ *  @brief A token bucket which limits the rate at which one or more readers get through data.
+ *
+ *  Readers call take() with the number of bytes that they have read (or are about to read)
+ *  and are blocked for as long as is needed to keep all of them, together, under the rate.
+ *  Up to a quarter of a second's worth of data can be taken at once after a pause.
+ *  The rate can be changed at any time, including while readers are blocked.
+ */
+class RateLimiter : public boost::noncopyable
+{
+public:
+	explicit RateLimiter (double bytes_per_second = 0);
+
+	void set_rate (double bytes_per_second);
+	double rate () const;
+
+	void take (int64_t bytes);
+
+private:
+	void refill ();
+
+	/** mutex to protect everything below */
+	mutable boost::mutex _mutex;
+	boost::condition_variable _condition;
+	/** rate in bytes per second, or 0 for no limit */
+	double _rate;
+	/** total number of bytes that have been asked for by take() */
+	double _taken;
+	/** total number of bytes that the bucket has allowed */
+	double _allowed;
+	/** time of the last refill(), in microseconds */
+	int64_t _last;
+};
+
+}
+
+#endif
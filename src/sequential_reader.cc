@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/sequential_reader.cc
+ *  @brief SequentialReader class.
+ */
+
+#include "sequential_reader.h"
+#include "util.h"
+#include "exceptions.h"
+#include "dcp_assert.h"
+#include "rate_limiter.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <cerrno>
+#ifdef LIBDCP_POSIX
+#include <fcntl.h>
+#endif
+
+using namespace dcp;
+
+/** @param file File to read.
+ *  @param drop_cache true to ask the operating system to drop the file's data from its page
+ *  cache once it has been read.
+ *  @param block_size Size of the blocks that read() will return, in bytes.
+ *  @param limiter Rate limiter to use for reads from the file, or 0.
+ */
+SequentialReader::SequentialReader (boost::filesystem::path file, bool drop_cache, int block_size, boost::shared_ptr<RateLimiter> limiter)
+	: _file (file)
+	, _handle (0)
+	, _size (0)
+	, _drop_cache (drop_cache)
+	, _block_size (block_size)
+	, _limiter (limiter)
+	, _stop (false)
+	, _next (0)
+	, _held (-1)
+	, _eof (false)
+	, _thread (0)
+{
+	DCP_ASSERT (_block_size > 0);
+
+	_handle = fopen_boost (_file, "rb");
+	if (!_handle) {
+		boost::throw_exception (FileError ("could not open file for reading", _file, errno));
+	}
+
+	/* Our blocks are big enough that stdio's buffer would only add a copy */
+	setvbuf (_handle, 0, _IONBF, 0);
+
+#ifdef LIBDCP_POSIX
+	posix_fadvise (fileno (_handle), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	try {
+		_size = boost::filesystem::file_size (_file);
+	} catch (...) {
+		fclose (_handle);
+		throw;
+	}
+
+	for (int i = 0; i < 2; ++i) {
+		_buffer[i].resize (_block_size);
+		_filled[i] = false;
+		_length[i] = 0;
+	}
+
+	_thread = new boost::thread (boost::bind (&SequentialReader::thread, this));
+}
+
+SequentialReader::~SequentialReader ()
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_stop = true;
+	}
+
+	_condition.notify_all ();
+	_thread->join ();
+	delete _thread;
+	fclose (_handle);
+}
+
+void
+SequentialReader::thread ()
+{
+	int i = 0;
+	int64_t offset = 0;
+	while (true) {
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			while (_filled[i] && !_stop) {
+				_condition.wait (lm);
+			}
+			if (_stop) {
+				return;
+			}
+		}
+
+		/* Buffer i belongs to us until we mark it as filled */
+		size_t const length = fread (&_buffer[i][0], 1, _block_size, _handle);
+		int const error = ferror (_handle) ? errno : 0;
+
+#ifdef LIBDCP_POSIX
+		if (_drop_cache && length > 0) {
+			/* We have our own copy of this data now, so the kernel need not keep it */
+			posix_fadvise (fileno (_handle), offset, length, POSIX_FADV_DONTNEED);
+		}
+#endif
+		offset += length;
+
+		{
+			boost::mutex::scoped_lock lm (_mutex);
+			_length[i] = length;
+			_filled[i] = true;
+			if (error) {
+				_error = error;
+			}
+		}
+
+		_condition.notify_all ();
+
+		if (length == 0 || error) {
+			return;
+		}
+
+		if (_limiter) {
+			_limiter->take (length);
+		}
+
+		i = 1 - i;
+	}
+}
+
+/** Get the next block of the file.
+ *  @param data Filled in with a pointer to the block, which remains valid until the next call to read().
+ *  @return Size of the block in bytes, or 0 at the end of the file.
+ */
+int
+SequentialReader::read (uint8_t const ** data)
+{
+	if (_eof) {
+		return 0;
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+
+	if (_held != -1) {
+		/* Let the thread have the caller's last block back */
+		_filled[_held] = false;
+		_held = -1;
+		_condition.notify_all ();
+	}
+
+	while (!_filled[_next]) {
+		_condition.wait (lm);
+	}
+
+	if (_error) {
+		_eof = true;
+		boost::throw_exception (FileError ("could not read file", _file, *_error));
+	}
+
+	int const length = _length[_next];
+	*data = &_buffer[_next][0];
+	_held = _next;
+	_next = 1 - _next;
+
+	if (length == 0) {
+		_eof = true;
+	}
+
+	return length;
+}
@@ -0,0 +1,119 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/sequential_reader.h
+ *  @brief SequentialReader class.
+ */
+
+#ifndef LIBDCP_SEQUENTIAL_READER_H
+#define LIBDCP_SEQUENTIAL_READER_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <stdint.h>
+#include <cstdio>
+#include <vector>
+
+namespace boost {
+	class thread;
+}
+
+namespace dcp {
+
+class RateLimiter;
+
+/** @class SequentialReader
+ *  @brief A reader of a whole file from start to finish, in large blocks.
+ *
+ *  A thread reads the next block into a second buffer while the caller is dealing
+ *  with the current one, so that reading from disk and whatever the caller does
+ *  with the data (e.g. hashing it) happen at the same time.
+ */
+class SequentialReader : public boost::noncopyable
+{
+public:
+	explicit SequentialReader (
+		boost::filesystem::path file,
+		bool drop_cache = false,
+		int block_size = 4 * 1024 * 1024,
+		boost::shared_ptr<RateLimiter> limiter = boost::shared_ptr<RateLimiter> ()
+		);
+	~SequentialReader ();
+
+	/** @return size of the file in bytes */
+	int64_t size () const {
+		return _size;
+	}
+
+	int read (uint8_t const ** data);
+
+private:
+	void thread ();
+
+	boost::filesystem::path _file;
+	FILE* _handle;
+	int64_t _size;
+	bool _drop_cache;
+	int _block_size;
+	boost::shared_ptr<RateLimiter> _limiter;
+	std::vector<uint8_t> _buffer[2];
+
+	/** mutex to protect _filled, _length, _error and _stop */
+	boost::mutex _mutex;
+	boost::condition_variable _condition;
+	/** true if a buffer has been filled by the thread and not yet finished with by the caller */
+	bool _filled[2];
+	/** number of bytes in each buffer */
+	int _length[2];
+	/** error number from a failed read, if there was one */
+	boost::optional<int> _error;
+	/** true if the thread should stop */
+	bool _stop;
+
+	/** index of the buffer that read() will return next */
+	int _next;
+	/** index of the buffer that the caller has from the last read(), or -1 */
+	int _held;
+	/** true if read() has reached the end of the file */
+	bool _eof;
+
+	boost::thread* _thread;
+};
+
+}
+
+#endif
@@ -41,11 +41,13 @@
 #include "sound_frame.h"
 #include "sound_asset_writer.h"
 #include "sound_asset_reader.h"
+#include "sound_range_reader.h"
 #include "compose.hpp"
 #include "dcp_assert.h"
+#include "raw_convert.h"
 #include <asdcp/KM_fileio.h>
 #include <asdcp/AS_DCP.h>
-#include <libxml++/nodes/element.h>
+#include <libxml++/libxml++.h>
 #include <boost/filesystem.hpp>
 #include <stdexcept>
 
@@ -54,11 +56,18 @@ using std::vector;
 using std::list;
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
+using boost::optional;
 using namespace dcp;
 
 SoundAsset::SoundAsset (boost::filesystem::path file)
 	: Asset (file)
 {
+	optional<string> id = read_cache (file, "Sound");
+	if (id) {
+		_id = *id;
+		return;
+	}
+
 	ASDCP::PCM::MXFReader reader;
 	Kumu::Result_t r = reader.OpenRead (file.string().c_str());
 	if (ASDCP_FAILURE (r)) {
@@ -82,6 +91,7 @@ SoundAsset::SoundAsset (boost::filesystem::path file)
 	}
 
 	_id = read_writer_info (info);
+	write_cache (file, "Sound", _id);
 }
 
 SoundAsset::SoundAsset (Fraction edit_rate, int sampling_rate, int channels, Standard standard)
@@ -192,6 +202,24 @@ SoundAsset::equals (shared_ptr<const Asset> other, EqualityOptions opt, NoteHand
 	return true;
 }
 
+void
+SoundAsset::read_cache_descriptor (cxml::ConstNodePtr node)
+{
+	_edit_rate = Fraction (node->string_child ("EditRate"));
+	_intrinsic_duration = node->number_child<int64_t> ("IntrinsicDuration");
+	_channels = node->number_child<int> ("Channels");
+	_sampling_rate = node->number_child<int> ("SamplingRate");
+}
+
+void
+SoundAsset::write_cache_descriptor (xmlpp::Element* node) const
+{
+	node->add_child("EditRate")->add_child_text (_edit_rate.as_string ());
+	node->add_child("IntrinsicDuration")->add_child_text (raw_convert<string> (_intrinsic_duration));
+	node->add_child("Channels")->add_child_text (raw_convert<string> (_channels));
+	node->add_child("SamplingRate")->add_child_text (raw_convert<string> (_sampling_rate));
+}
+
 shared_ptr<SoundAssetWriter>
 SoundAsset::start_write (boost::filesystem::path file)
 {
@@ -205,6 +233,24 @@ SoundAsset::start_read () const
 	return shared_ptr<SoundAssetReader> (new SoundAssetReader (this, key(), standard()));
 }
 
+/** @return A reader which can read arbitrary ranges of samples from this asset */
+shared_ptr<SoundRangeReader>
+SoundAsset::start_range_read () const
+{
+	int64_t const samples_per_frame = int64_t (_sampling_rate) * _edit_rate.denominator / _edit_rate.numerator;
+	return shared_ptr<SoundRangeReader> (
+		new SoundRangeReader (start_read(), _channels, samples_per_frame, samples_per_frame * _intrinsic_duration)
+		);
+}
+
+vector<FrameIndexEntry>
+SoundAsset::frame_index () const
+{
+	DCP_ASSERT (_file);
+
+	return cached_frame_index<ASDCP::PCM::MXFReader> (_file.get(), _intrinsic_duration);
+}
+
 string
 SoundAsset::static_pkl_type (Standard standard)
 {
@@ -48,6 +48,7 @@ namespace dcp
 {
 
 class SoundAssetWriter;
+class SoundRangeReader;
 
 /** @class SoundAsset
  *  @brief Representation of a sound asset
@@ -60,6 +61,10 @@ public:
 
 	boost::shared_ptr<SoundAssetWriter> start_write (boost::filesystem::path file);
 	boost::shared_ptr<SoundAssetReader> start_read () const;
+	boost::shared_ptr<SoundRangeReader> start_range_read () const;
+
+	/** @return the position and size of each frame's essence in our file, read from the MXF index table */
+	std::vector<FrameIndexEntry> frame_index () const;
 
 	bool equals (
 		boost::shared_ptr<const Asset> other,
@@ -95,6 +100,9 @@ private:
 		return static_pkl_type (standard);
 	}
 
+	void read_cache_descriptor (cxml::ConstNodePtr node);
+	void write_cache_descriptor (xmlpp::Element* node) const;
+
 	Fraction _edit_rate;
 	/** The total length of this content in video frames.  The amount of
 	 *  content presented may be less than this.
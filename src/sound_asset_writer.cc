@@ -37,18 +37,32 @@
 #include "dcp_assert.h"
 #include "compose.hpp"
 #include "crypto_context.h"
+#include "util.h"
 #include <asdcp/AS_DCP.h>
+#include <boost/bind.hpp>
 #include <iostream>
 
 using std::min;
 using std::max;
 using std::cout;
+using std::vector;
+using boost::shared_ptr;
 using namespace dcp;
 
 struct SoundAssetWriter::ASDCPState
 {
+	void write (ASDCP::PCM::FrameBuffer const & buffer, EncryptionContext* crypto)
+	{
+		ASDCP::Result_t const r = mxf_writer.WriteFrame (buffer, crypto->context(), crypto->hmac());
+		if (ASDCP_FAILURE (r)) {
+			boost::throw_exception (MiscError (String::compose ("could not write audio MXF frame (%1)", int (r))));
+		}
+	}
+
 	ASDCP::PCM::MXFWriter mxf_writer;
 	ASDCP::PCM::FrameBuffer frame_buffer;
+	/** buffer used by the writer thread to point at queued frames */
+	ASDCP::PCM::FrameBuffer queued_frame_buffer;
 	ASDCP::WriterInfo writer_info;
 	ASDCP::PCM::AudioDescriptor desc;
 };
@@ -89,53 +103,164 @@ SoundAssetWriter::SoundAssetWriter (SoundAsset* asset, boost::filesystem::path f
 	_asset->fill_writer_info (&_state->writer_info, _asset->id());
 }
 
+SoundAssetWriter::~SoundAssetWriter ()
+{
+	/* Queued writes use _state, so they must finish before it goes away */
+	stop_asynchronous ();
+}
+
+/** Largest float sample value that we can represent in 24 bits */
+static float const clip = 1.0f - (1.0f / (1 << 23));
+
+/** Convert a float sample to a 24-bit integer, clipping if necessary.  Clipping uses
+ *  min/max rather than branches so that loops using this can be vectorised.
+ */
+static inline int32_t
+float_to_24 (float x)
+{
+	return int32_t (min (max (x, -clip), clip) * (1 << 23));
+}
+
+/** Clip a sign-extended 24-bit sample held in an int32_t */
+static inline int32_t
+clip_24 (int32_t x)
+{
+	return min (max (x, -(1 << 23)), (1 << 23) - 1);
+}
+
+static inline void
+pack_24 (uint8_t* out, int32_t s)
+{
+	out[0] = s & 0xff;
+	out[1] = (s >> 8) & 0xff;
+	out[2] = (s >> 16) & 0xff;
+}
+
+static void
+pack_planar_float (float const * const * data, int channels, int from, int samples, uint8_t* out)
+{
+	for (int i = from; i < from + samples; ++i) {
+		for (int j = 0; j < channels; ++j) {
+			pack_24 (out, float_to_24 (data[j][i]));
+			out += 3;
+		}
+	}
+}
+
+static void
+pack_interleaved_float (float const * data, int channels, int from, int samples, uint8_t* out)
+{
+	float const * in = data + from * channels;
+	int const N = samples * channels;
+	for (int i = 0; i < N; ++i) {
+		pack_24 (out + i * 3, float_to_24 (in[i]));
+	}
+}
+
+static void
+pack_interleaved_int (int32_t const * data, int channels, int from, int samples, uint8_t* out)
+{
+	int32_t const * in = data + from * channels;
+	int const N = samples * channels;
+	for (int i = 0; i < N; ++i) {
+		pack_24 (out + i * 3, clip_24 (in[i]));
+	}
+}
+
+static void
+copy_packed (uint8_t const * data, int channels, int from, int samples, uint8_t* out)
+{
+	memcpy (out, data + from * channels * 3, samples * channels * 3);
+}
+
+/** Write some planar float samples.
+ *  @param data Array of pointers to the samples for each channel; samples should be between -1 and 1,
+ *  and will be clipped if not.
+ *  @param frames Number of samples per channel.
+ */
 void
 SoundAssetWriter::write (float const * const * data, int frames)
+{
+	write_samples (frames, boost::bind (&pack_planar_float, data, _1, _2, _3, _4));
+}
+
+/** Write some interleaved float samples.
+ *  @param data Samples (channel 0 of the first sample, channel 1 of the first sample, and so on);
+ *  these should be between -1 and 1, and will be clipped if not.
+ *  @param frames Number of samples per channel.
+ */
+void
+SoundAssetWriter::write_interleaved (float const * data, int frames)
+{
+	write_samples (frames, boost::bind (&pack_interleaved_float, data, _1, _2, _3, _4));
+}
+
+/** Write some interleaved integer samples.
+ *  @param data Samples (channel 0 of the first sample, channel 1 of the first sample, and so on);
+ *  these are 24-bit values in the low bits, sign-extended, as returned by SoundFrame::get().  They will be
+ *  clipped if they are out of range.
+ *  @param frames Number of samples per channel.
+ */
+void
+SoundAssetWriter::write_interleaved (int32_t const * data, int frames)
+{
+	write_samples (frames, boost::bind (&pack_interleaved_int, data, _1, _2, _3, _4));
+}
+
+/** Write some samples which are already interleaved and packed as 3-byte little-endian signed
+ *  integers, as they are stored in the MXF.
+ *  @param data Samples.
+ *  @param frames Number of samples per channel.
+ */
+void
+SoundAssetWriter::write_packed (uint8_t const * data, int frames)
+{
+	write_samples (frames, boost::bind (&copy_packed, data, _1, _2, _3, _4));
+}
+
+/** Write samples into our frame buffer, writing MXF frames as they fill up.
+ *  @param frames Number of samples per channel to write.
+ *  @param pack Function to pack some samples into the frame buffer; its parameters are the number of channels,
+ *  index of the first sample to pack, number of samples to pack and the place to put them.
+ */
+void
+SoundAssetWriter::write_samples (int frames, boost::function<void (int, int, int, uint8_t*)> pack)
 {
 	DCP_ASSERT (!_finalized);
 	DCP_ASSERT (frames > 0);
 
-	static float const clip = 1.0f - (1.0f / pow (2, 23));
-
 	if (!_started) {
 		Kumu::Result_t r = _state->mxf_writer.OpenWrite (_file.string().c_str(), _state->writer_info, _state->desc);
 		if (ASDCP_FAILURE (r)) {
 			boost::throw_exception (FileError ("could not open audio MXF for writing", _file.string(), r));
 		}
 
+		preallocate ();
 		_asset->set_file (_file);
 		_started = true;
 	}
 
 	int const ch = _asset->channels ();
+	int const capacity = _state->frame_buffer.Capacity ();
 
-	for (int i = 0; i < frames; ++i) {
-
-		byte_t* out = _state->frame_buffer.Data() + _frame_buffer_offset;
-
-		/* Write one sample per channel */
-		for (int j = 0; j < ch; ++j) {
-			/* Convert sample to 24-bit int, clipping if necessary. */
-			float x = data[j][i];
-			if (x > clip) {
-				x = clip;
-			} else if (x < -clip) {
-				x = -clip;
-			}
-			int32_t const s = x * (1 << 23);
-			*out++ = (s & 0xff);
-			*out++ = (s & 0xff00) >> 8;
-			*out++ = (s & 0xff0000) >> 16;
-		}
-		_frame_buffer_offset += 3 * ch;
+	int done = 0;
+	while (done < frames) {
+		/* Fill as much of the current MXF frame as we can */
+		int const space = (capacity - _frame_buffer_offset) / (3 * ch);
+		int const this_time = min (frames - done, space);
+
+		pack (ch, done, this_time, _state->frame_buffer.Data() + _frame_buffer_offset);
+		_frame_buffer_offset += 3 * ch * this_time;
+		done += this_time;
 
-		DCP_ASSERT (_frame_buffer_offset <= int (_state->frame_buffer.Capacity()));
+		DCP_ASSERT (_frame_buffer_offset <= capacity);
 
-		/* Finish the MXF frame if required */
-		if (_frame_buffer_offset == int (_state->frame_buffer.Capacity())) {
+		/* Finish the MXF frame if required; there's no need to clear the buffer
+		   as the next frame's samples will overwrite all of it.
+		*/
+		if (_frame_buffer_offset == capacity) {
 			write_current_frame ();
 			_frame_buffer_offset = 0;
-			memset (_state->frame_buffer.Data(), 0, _state->frame_buffer.Capacity());
 		}
 	}
 }
@@ -143,28 +268,53 @@ SoundAssetWriter::write (float const * const * data, int frames)
 void
 SoundAssetWriter::write_current_frame ()
 {
-	ASDCP::Result_t const r = _state->mxf_writer.WriteFrame (_state->frame_buffer, _crypto_context->context(), _crypto_context->hmac());
-	if (ASDCP_FAILURE (r)) {
-		boost::throw_exception (MiscError (String::compose ("could not write audio MXF frame (%1)", int (r))));
+	if (_writer_thread) {
+		/* Copy the frame so that we can carry on filling _state->frame_buffer */
+		uint8_t const * data = _state->frame_buffer.RoData ();
+		shared_ptr<vector<uint8_t> > copy (new vector<uint8_t> (data, data + _state->frame_buffer.Size()));
+		queue (boost::bind (&SoundAssetWriter::write_queued_frame, this, copy));
+		return;
 	}
 
-	++_frames_written;
+	int64_t const start = monotonic_microseconds ();
+	_state->write (_state->frame_buffer, _crypto_context.get());
+	add_stats (_state->frame_buffer.Size(), 0, monotonic_microseconds () - start);
+	frame_written ();
+}
+
+/** Called on the writer thread to write a frame that was copied by write_current_frame() */
+void
+SoundAssetWriter::write_queued_frame (shared_ptr<vector<uint8_t> > data)
+{
+	_state->queued_frame_buffer.SetData (&(*data)[0], data->size());
+	_state->queued_frame_buffer.Size (data->size());
+	int64_t const start = monotonic_microseconds ();
+	_state->write (_state->queued_frame_buffer, _crypto_context.get());
+	add_stats (data->size(), 0, monotonic_microseconds () - start);
+	frame_written ();
 }
 
 bool
 SoundAssetWriter::finalize ()
 {
 	if (_frame_buffer_offset > 0) {
+		/* Pad the last frame with silence */
+		memset (_state->frame_buffer.Data() + _frame_buffer_offset, 0, _state->frame_buffer.Capacity() - _frame_buffer_offset);
 		write_current_frame ();
 	}
 
+	drain ();
+
 	if (_started) {
 		ASDCP::Result_t const r = _state->mxf_writer.Finalize();
 		if (ASDCP_FAILURE(r)) {
 			boost::throw_exception (MiscError (String::compose ("could not finalise audio MXF (%1)", int(r))));
 		}
+		if (_hash_on_finalize) {
+			_asset->set_hash (make_digest (_file, 0));
+		}
 	}
 
-	_asset->_intrinsic_duration = _frames_written;
+	_asset->_intrinsic_duration = frames_written ();
 	return AssetWriter::finalize ();
 }
@@ -40,6 +40,8 @@
 #include "sound_frame.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+#include <vector>
 
 namespace dcp {
 
@@ -51,13 +53,22 @@ class SoundAsset;
  *  Objects of this class can only be created with SoundAsset::start_write().
  *
  *  Sound samples can be written to the SoundAsset by calling write() with
- *  a buffer of float values.  finalize() must be called after the last samples
- *  have been written.
+ *  planar float values, write_interleaved() with interleaved float or integer values,
+ *  or write_packed() with data that is already in the MXF's 24-bit format.
+ *  finalize() must be called after the last samples have been written.
+ *
+ *  If the writer is asynchronous the samples are still packed by the caller, but
+ *  completed frames are written by the writer thread.
  */
 class SoundAssetWriter : public AssetWriter
 {
 public:
+	~SoundAssetWriter ();
+
 	void write (float const * const *, int);
+	void write_interleaved (float const *, int);
+	void write_interleaved (int32_t const *, int);
+	void write_packed (uint8_t const *, int);
 	bool finalize ();
 
 private:
@@ -65,7 +76,9 @@ private:
 
 	SoundAssetWriter (SoundAsset *, boost::filesystem::path);
 
+	void write_samples (int frames, boost::function<void (int, int, int, uint8_t*)> pack);
 	void write_current_frame ();
+	void write_queued_frame (boost::shared_ptr<std::vector<uint8_t> > data);
 
 	/* do this with an opaque pointer so we don't have to include
 	   ASDCP headers
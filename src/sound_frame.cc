@@ -32,20 +32,80 @@
 */
 
 #include "sound_frame.h"
+#include "dcp_assert.h"
 #include <asdcp/AS_DCP.h>
 #include <iostream>
 
 using std::cout;
+using std::vector;
 using namespace dcp;
 
-SoundFrame::SoundFrame (ASDCP::PCM::MXFReader* reader, int n, boost::shared_ptr<const DecryptionContext> c)
-	: Frame<ASDCP::PCM::MXFReader, ASDCP::PCM::FrameBuffer> (reader, n, c)
+/** Scale factor to convert a sign-extended 24-bit sample to a float between -1 and 1 */
+static float const to_float = 1.0f / (1 << 23);
+
+/** Read a little-endian 24-bit sample and sign-extend it to 32 bits */
+static inline int32_t
+extend (uint8_t const * d)
+{
+	return static_cast<int32_t> ((uint32_t (d[0]) << 8) | (uint32_t (d[1]) << 16) | (uint32_t (d[2]) << 24)) >> 8;
+}
+
+static inline void
+store (int32_t* out, int32_t s)
+{
+	*out = s;
+}
+
+static inline void
+store (float* out, int32_t s)
+{
+	*out = s * to_float;
+}
+
+/** Copy every channel from some interleaved 24-bit samples to planar buffers.  The loops
+ *  are kept simple, with no calls per sample, so that the compiler can vectorise them.
+ */
+template <class T>
+static void
+deinterleave (uint8_t const * in, int samples, int channels, T* const * out)
+{
+	for (int i = 0; i < samples; ++i) {
+		for (int j = 0; j < channels; ++j) {
+			store (out[j] + i, extend (in));
+			in += 3;
+		}
+	}
+}
+
+/** Copy some channels from interleaved 24-bit samples to planar buffers, touching only
+ *  the bytes of the channels that are wanted.
+ *  @param in First sample to copy.
+ */
+template <class T>
+static void
+deinterleave (uint8_t const * in, int samples, int channels, vector<int> const & wanted, T* const * out)
+{
+	int const stride = channels * 3;
+	for (size_t j = 0; j < wanted.size(); ++j) {
+		DCP_ASSERT (wanted[j] >= 0 && wanted[j] < channels);
+		uint8_t const * p = in + wanted[j] * 3;
+		T* o = out[j];
+		for (int i = 0; i < samples; ++i) {
+			store (o + i, extend (p));
+			p += stride;
+		}
+	}
+}
+
+SoundFrame::SoundFrame (ASDCP::PCM::MXFReader* reader, int n, boost::shared_ptr<const DecryptionContext> c, bool decrypt)
+	: Frame<ASDCP::PCM::MXFReader, ASDCP::PCM::FrameBuffer> (reader, n, c, decrypt)
 {
 	ASDCP::PCM::AudioDescriptor desc;
 	reader->FillAudioDescriptor (desc);
 	_channels = desc.ChannelCount;
 }
 
+/** @return Sample from a channel, as an unsigned 24-bit value (i.e. not sign-extended) */
 int32_t
 SoundFrame::get (int channel, int frame) const
 {
@@ -58,3 +118,67 @@ SoundFrame::samples () const
 {
 	return size() / (_channels * 3);
 }
+
+/** Get all samples in this frame as sign-extended 24-bit values.
+ *  @param data Array of channels() pointers, each to space for samples() values.
+ */
+void
+SoundFrame::get (int32_t* const * data) const
+{
+	deinterleave (this->data(), samples(), _channels, data);
+}
+
+/** Get all samples in this frame as floats between -1 and 1.
+ *  @param data Array of channels() pointers, each to space for samples() values.
+ */
+void
+SoundFrame::get (float* const * data) const
+{
+	deinterleave (this->data(), samples(), _channels, data);
+}
+
+/** Get the samples of some channels in this frame as sign-extended 24-bit values.
+ *  @param channels Indices of the channels to get.
+ *  @param data Array of pointers, one per entry in channels, each to space for samples() values.
+ */
+void
+SoundFrame::get (vector<int> const & channels, int32_t* const * data) const
+{
+	deinterleave (this->data(), samples(), _channels, channels, data);
+}
+
+/** Get the samples of some channels in this frame as floats between -1 and 1.
+ *  @param channels Indices of the channels to get.
+ *  @param data Array of pointers, one per entry in channels, each to space for samples() values.
+ */
+void
+SoundFrame::get (vector<int> const & channels, float* const * data) const
+{
+	deinterleave (this->data(), samples(), _channels, channels, data);
+}
+
+/** Get some of the samples of some channels in this frame as sign-extended 24-bit values.
+ *  @param from First sample to get.
+ *  @param length Number of samples to get.
+ *  @param channels Indices of the channels to get.
+ *  @param data Array of pointers, one per entry in channels, each to space for length values.
+ */
+void
+SoundFrame::get (int from, int length, vector<int> const & channels, int32_t* const * data) const
+{
+	DCP_ASSERT (from >= 0 && length >= 0 && (from + length) <= samples());
+	deinterleave (this->data() + from * _channels * 3, length, _channels, channels, data);
+}
+
+/** Get some of the samples of some channels in this frame as floats between -1 and 1.
+ *  @param from First sample to get.
+ *  @param length Number of samples to get.
+ *  @param channels Indices of the channels to get.
+ *  @param data Array of pointers, one per entry in channels, each to space for length values.
+ */
+void
+SoundFrame::get (int from, int length, vector<int> const & channels, float* const * data) const
+{
+	DCP_ASSERT (from >= 0 && length >= 0 && (from + length) <= samples());
+	deinterleave (this->data() + from * _channels * 3, length, _channels, channels, data);
+}
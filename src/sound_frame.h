@@ -40,16 +40,27 @@
 
 #include "frame.h"
 #include <asdcp/AS_DCP.h>
+#include <vector>
 
 namespace dcp {
 
 class SoundFrame : public Frame<ASDCP::PCM::MXFReader, ASDCP::PCM::FrameBuffer>
 {
 public:
-	SoundFrame (ASDCP::PCM::MXFReader* reader, int n, boost::shared_ptr<const DecryptionContext> c);
+	SoundFrame (ASDCP::PCM::MXFReader* reader, int n, boost::shared_ptr<const DecryptionContext> c, bool decrypt = true);
 	int samples () const;
+	int channels () const {
+		return _channels;
+	}
 	int32_t get (int channel, int sample) const;
 
+	void get (int32_t* const * data) const;
+	void get (float* const * data) const;
+	void get (std::vector<int> const & channels, int32_t* const * data) const;
+	void get (std::vector<int> const & channels, float* const * data) const;
+	void get (int from, int length, std::vector<int> const & channels, int32_t* const * data) const;
+	void get (int from, int length, std::vector<int> const & channels, float* const * data) const;
+
 private:
 	int _channels;
 };
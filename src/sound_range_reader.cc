@@ -0,0 +1,153 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/sound_range_reader.cc
+ *  @brief SoundRangeReader class.
+ */
+
+#include "sound_range_reader.h"
+#include "sound_frame.h"
+#include "exceptions.h"
+#include "dcp_assert.h"
+#include "compose.hpp"
+#include <algorithm>
+
+using std::min;
+using std::vector;
+using boost::shared_ptr;
+using namespace dcp;
+
+/** @param reader Reader for the asset.
+ *  @param channels Number of channels in the asset.
+ *  @param samples_per_frame Number of samples in each of the asset's frames.
+ *  @param length Length of the asset in samples.
+ */
+SoundRangeReader::SoundRangeReader (shared_ptr<SoundAssetReader> reader, int channels, int samples_per_frame, int64_t length)
+	: _reader (reader)
+	, _channels (channels)
+	, _samples_per_frame (samples_per_frame)
+	, _length (length)
+	, _frame_index (-1)
+{
+	DCP_ASSERT (_samples_per_frame > 0);
+
+	for (int i = 0; i < _channels; ++i) {
+		_all_channels.push_back (i);
+	}
+}
+
+/** Read all channels of a range of samples as sign-extended 24-bit values.
+ *  @param from First sample to read, counting from the start of the asset.
+ *  @param length Number of samples to read.
+ *  @param data Array of channels() pointers, each to space for length values.
+ */
+void
+SoundRangeReader::read (int64_t from, int length, int32_t* const * data)
+{
+	read_range (from, length, _all_channels, data);
+}
+
+/** Read all channels of a range of samples as floats between -1 and 1.
+ *  @param from First sample to read, counting from the start of the asset.
+ *  @param length Number of samples to read.
+ *  @param data Array of channels() pointers, each to space for length values.
+ */
+void
+SoundRangeReader::read (int64_t from, int length, float* const * data)
+{
+	read_range (from, length, _all_channels, data);
+}
+
+/** Read some channels of a range of samples as sign-extended 24-bit values.
+ *  @param from First sample to read, counting from the start of the asset.
+ *  @param length Number of samples to read.
+ *  @param channels Indices of the channels to read.
+ *  @param data Array of pointers, one per entry in channels, each to space for length values.
+ */
+void
+SoundRangeReader::read (int64_t from, int length, vector<int> const & channels, int32_t* const * data)
+{
+	read_range (from, length, channels, data);
+}
+
+/** Read some channels of a range of samples as floats between -1 and 1.
+ *  @param from First sample to read, counting from the start of the asset.
+ *  @param length Number of samples to read.
+ *  @param channels Indices of the channels to read.
+ *  @param data Array of pointers, one per entry in channels, each to space for length values.
+ */
+void
+SoundRangeReader::read (int64_t from, int length, vector<int> const & channels, float* const * data)
+{
+	read_range (from, length, channels, data);
+}
+
+template <class T>
+void
+SoundRangeReader::read_range (int64_t from, int length, vector<int> const & channels, T* const * data)
+{
+	if (from < 0 || length < 0 || (from + length) > _length) {
+		boost::throw_exception (DCPReadError (String::compose ("sample range %1 to %2 is outside the asset", from, from + length)));
+	}
+
+	if (channels.empty ()) {
+		return;
+	}
+
+	vector<T*> out (data, data + channels.size());
+
+	int done = 0;
+	while (done < length) {
+		int64_t const position = from + done;
+		int const frame = position / _samples_per_frame;
+		int const offset = position % _samples_per_frame;
+		int const this_time = min (length - done, _samples_per_frame - offset);
+
+		if (frame != _frame_index) {
+			_frame_index = -1;
+			_reader->get_frame (frame, _frame);
+			if (_frame->samples() != _samples_per_frame) {
+				boost::throw_exception (DCPReadError (String::compose ("sound frame %1 has %2 samples rather than %3", frame, _frame->samples(), _samples_per_frame)));
+			}
+			_frame_index = frame;
+		}
+
+		_frame->get (offset, this_time, channels, &out[0]);
+
+		for (size_t i = 0; i < out.size(); ++i) {
+			out[i] += this_time;
+		}
+
+		done += this_time;
+	}
+}
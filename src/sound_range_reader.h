@@ -0,0 +1,98 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/sound_range_reader.h
+ *  @brief SoundRangeReader class.
+ */
+
+#ifndef LIBDCP_SOUND_RANGE_READER_H
+#define LIBDCP_SOUND_RANGE_READER_H
+
+#include "sound_asset_reader.h"
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace dcp {
+
+/** @class SoundRangeReader
+ *  @brief Reader for arbitrary ranges of samples from a sound asset, regardless of where
+ *  its frame boundaries fall.
+ *
+ *  Only the frames which overlap a requested range are read, and the most recently read
+ *  frame is kept (and its buffer re-used) so that consecutive ranges can be read efficiently.
+ *  Output is planar, with one contiguous buffer per channel.
+ */
+class SoundRangeReader : public boost::noncopyable
+{
+public:
+	SoundRangeReader (boost::shared_ptr<SoundAssetReader> reader, int channels, int samples_per_frame, int64_t length);
+
+	/** @return total length of the asset in samples */
+	int64_t length () const {
+		return _length;
+	}
+
+	int channels () const {
+		return _channels;
+	}
+
+	int samples_per_frame () const {
+		return _samples_per_frame;
+	}
+
+	void read (int64_t from, int length, int32_t* const * data);
+	void read (int64_t from, int length, float* const * data);
+	void read (int64_t from, int length, std::vector<int> const & channels, int32_t* const * data);
+	void read (int64_t from, int length, std::vector<int> const & channels, float* const * data);
+
+private:
+	template <class T>
+	void read_range (int64_t from, int length, std::vector<int> const & channels, T* const * data);
+
+	boost::shared_ptr<SoundAssetReader> _reader;
+	int _channels;
+	int _samples_per_frame;
+	int64_t _length;
+	/** indices of all our channels */
+	std::vector<int> _all_channels;
+	/** most recently read frame, or 0 */
+	boost::shared_ptr<const SoundFrame> _frame;
+	/** index of _frame within the asset */
+	int _frame_index;
+};
+
+}
+
+#endif
@@ -40,15 +40,23 @@
 #include <asdcp/AS_DCP.h>
 
 using std::string;
+using std::vector;
 using std::pair;
 using std::make_pair;
 using boost::shared_ptr;
 using boost::dynamic_pointer_cast;
+using boost::optional;
 using namespace dcp;
 
 StereoPictureAsset::StereoPictureAsset (boost::filesystem::path file)
 	: PictureAsset (file)
 {
+	optional<string> id = read_cache (file, "StereoPicture");
+	if (id) {
+		_id = *id;
+		return;
+	}
+
 	ASDCP::JP2K::MXFSReader reader;
 	Kumu::Result_t r = reader.OpenRead (file.string().c_str());
 	if (ASDCP_FAILURE (r)) {
@@ -68,6 +76,7 @@ StereoPictureAsset::StereoPictureAsset (boost::filesystem::path file)
 	}
 
 	_id = read_writer_info (info);
+	write_cache (file, "StereoPicture", _id);
 }
 
 StereoPictureAsset::StereoPictureAsset (Fraction edit_rate, Standard standard)
@@ -88,6 +97,14 @@ StereoPictureAsset::start_read () const
 	return shared_ptr<StereoPictureAssetReader> (new StereoPictureAssetReader (this, key(), standard()));
 }
 
+vector<FrameIndexEntry>
+StereoPictureAsset::frame_index () const
+{
+	DCP_ASSERT (_file);
+
+	return cached_frame_index<ASDCP::JP2K::MXFSReader> (_file.get(), _intrinsic_duration);
+}
+
 bool
 StereoPictureAsset::equals (shared_ptr<const Asset> other, EqualityOptions opt, NoteHandler note) const
 {
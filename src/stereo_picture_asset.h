@@ -50,6 +50,11 @@ public:
 	boost::shared_ptr<PictureAssetWriter> start_write (boost::filesystem::path file, bool);
 	boost::shared_ptr<StereoPictureAssetReader> start_read () const;
 
+	/** @return the position and size of each frame's essence in our file, read from the MXF index table;
+	 *  each entry covers both eyes (left then right).
+	 */
+	std::vector<FrameIndexEntry> frame_index () const;
+
 	bool equals (
 		boost::shared_ptr<const Asset> other,
 		EqualityOptions opt,
@@ -36,6 +36,7 @@
 #include "dcp_assert.h"
 #include "picture_asset.h"
 #include "crypto_context.h"
+#include "util.h"
 #include <asdcp/AS_DCP.h>
 #include <asdcp/KM_fileio.h>
 
@@ -58,11 +59,18 @@ StereoPictureAssetWriter::StereoPictureAssetWriter (PictureAsset* mxf, boost::fi
 
 }
 
+StereoPictureAssetWriter::~StereoPictureAssetWriter ()
+{
+	/* Queued writes use _state, so they must finish before it goes away */
+	stop_asynchronous ();
+}
+
 void
 StereoPictureAssetWriter::start (uint8_t const * data, int size)
 {
 	dcp::start (this, _state, _picture_asset, data, size);
 	_picture_asset->set_frame_rate (Fraction (_picture_asset->edit_rate().numerator * 2, _picture_asset->edit_rate().denominator));
+	skip_resumed_frames ();
 }
 
 /** Write a frame for one eye.  Frames must be written left, then right, then left etc.
@@ -78,15 +86,15 @@ StereoPictureAssetWriter::write (uint8_t const * data, int size)
 		start (data, size);
 	}
 
- 	if (ASDCP_FAILURE (_state->j2k_parser.OpenReadFrame (data, size, _state->frame_buffer))) {
- 		boost::throw_exception (MiscError ("could not parse J2K frame"));
- 	}
+	int64_t const parse_start = monotonic_microseconds ();
+	ASDCP::JP2K::FrameBuffer const & buffer = prepare_frame (_state.get(), data, size);
+	int64_t const write_start = monotonic_microseconds ();
 
 	uint64_t const before_offset = _state->mxf_writer.Tell ();
 
 	string hash;
 	Kumu::Result_t r = _state->mxf_writer.WriteFrame (
-		_state->frame_buffer,
+		buffer,
 		_next_eye == EYE_LEFT ? ASDCP::JP2K::SP_LEFT : ASDCP::JP2K::SP_RIGHT,
 		_crypto_context->context(),
 		_crypto_context->hmac(),
@@ -100,10 +108,13 @@ StereoPictureAssetWriter::write (uint8_t const * data, int size)
 	_next_eye = _next_eye == EYE_LEFT ? EYE_RIGHT : EYE_LEFT;
 
 	if (_next_eye == EYE_LEFT) {
-		++_frames_written;
+		frame_written ();
 	}
 
-	return FrameInfo (before_offset, _state->mxf_writer.Tell() - before_offset, hash);
+	FrameInfo const info (before_offset, _state->mxf_writer.Tell() - before_offset, hash);
+	add_stats (info.size, write_start - parse_start, monotonic_microseconds () - write_start);
+	add_to_journal (info);
+	return info;
 }
 
 void
@@ -119,20 +130,26 @@ StereoPictureAssetWriter::fake_write (int size)
 
 	_next_eye = _next_eye == EYE_LEFT ? EYE_RIGHT : EYE_LEFT;
 	if (_next_eye == EYE_LEFT) {
-		++_frames_written;
+		frame_written ();
 	}
 }
 
 bool
 StereoPictureAssetWriter::finalize ()
 {
+	check_reorder_buffer ();
+	drain ();
+
 	if (_started) {
 		Kumu::Result_t r = _state->mxf_writer.Finalize();
 		if (ASDCP_FAILURE (r)) {
 			boost::throw_exception (MXFFileError ("error in finalizing video MXF", _file.string(), r));
 		}
+		if (_hash_on_finalize) {
+			_picture_asset->set_hash (make_digest (_file, 0));
+		}
 	}
 
-	_picture_asset->_intrinsic_duration = _frames_written;
+	_picture_asset->_intrinsic_duration = frames_written ();
 	return PictureAssetWriter::finalize ();
 }
@@ -54,6 +54,10 @@ namespace dcp {
 class StereoPictureAssetWriter : public PictureAssetWriter
 {
 public:
+	~StereoPictureAssetWriter ();
+
+	using PictureAssetWriter::write;
+
 	/** Write a frame for one eye.  Frames must be written left, then right, then left etc.
 	 *  @param data JPEG2000 data.
 	 *  @param size Size of data.
@@ -49,17 +49,48 @@ using namespace dcp;
 /** Make a picture frame from a 3D (stereoscopic) asset.
  *  @param reader Reader for the MXF file.
  *  @param n Frame within the asset, not taking EntryPoint into account.
+ *  @param decrypt false to leave the ciphertext in place if c says that decryption
+ *  should happen after reading; decrypt() must then be called.
  */
-StereoPictureFrame::StereoPictureFrame (ASDCP::JP2K::MXFSReader* reader, int n, shared_ptr<DecryptionContext> c)
+StereoPictureFrame::StereoPictureFrame (ASDCP::JP2K::MXFSReader* reader, int n, shared_ptr<DecryptionContext> c, bool decrypt)
 {
 	/* XXX: unfortunate guesswork on this buffer size */
 	_buffer = new ASDCP::JP2K::SFrameBuffer (4 * Kumu::Megabyte);
 
-	if (ASDCP_FAILURE (reader->ReadFrame (n, *_buffer, c->context(), c->hmac()))) {
+	ASDCP::Result_t r;
+	if (c->decrypt_after_read ()) {
+		/* Each eye is a separate triplet with its own CBC chain, so read them separately */
+		r = reader->ReadFrame (n, ASDCP::JP2K::SP_LEFT, _buffer->Left, 0, 0);
+		if (ASDCP_SUCCESS (r)) {
+			r = reader->ReadFrame (n, ASDCP::JP2K::SP_RIGHT, _buffer->Right, 0, 0);
+		}
+		if (ASDCP_SUCCESS (r) && decrypt) {
+			this->decrypt (n, c);
+		}
+	} else {
+		r = reader->ReadFrame (n, *_buffer, c->context(), c->hmac());
+	}
+
+	if (ASDCP_FAILURE (r)) {
 		boost::throw_exception (DCPReadError (String::compose ("could not read video frame %1 of %2", n)));
 	}
 }
 
+/** Decrypt a frame which was constructed with decrypt set to false */
+void
+StereoPictureFrame::decrypt (int n, shared_ptr<const DecryptionContext> c)
+{
+	/* The eyes are numbered 2n + 1 and 2n + 2 in the MXF's sequence */
+	ASDCP::Result_t r = c->decrypt (_buffer->Left, n, n * 2 + 1);
+	if (ASDCP_SUCCESS (r)) {
+		r = c->decrypt (_buffer->Right, n, n * 2 + 2);
+	}
+
+	if (ASDCP_FAILURE (r)) {
+		boost::throw_exception (DCPReadError (String::compose ("could not decrypt video frame %1 (%2)", n, static_cast<int>(r))));
+	}
+}
+
 StereoPictureFrame::StereoPictureFrame ()
 {
 	_buffer = new ASDCP::JP2K::SFrameBuffer (4 * Kumu::Megabyte);
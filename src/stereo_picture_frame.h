@@ -77,7 +77,8 @@ private:
 	*/
 	friend class AssetReader<ASDCP::JP2K::MXFSReader, StereoPictureFrame>;
 
-	StereoPictureFrame (ASDCP::JP2K::MXFSReader* reader, int n, boost::shared_ptr<DecryptionContext>);
+	StereoPictureFrame (ASDCP::JP2K::MXFSReader* reader, int n, boost::shared_ptr<DecryptionContext>, bool decrypt = true);
+	void decrypt (int n, boost::shared_ptr<const DecryptionContext> c);
 
 	ASDCP::JP2K::SFrameBuffer* _buffer;
 };
@@ -160,6 +160,14 @@ enum Eye
 	EYE_RIGHT
 };
 
+/** How large reads of files (for hashing and verification) should treat the operating system's page cache */
+enum ReadCacheMode
+{
+	READ_CACHE_DEFAULT, ///< use the mode given to set_read_cache_mode()
+	READ_CACHE_KEEP,    ///< leave data in the page cache as for any other read
+	READ_CACHE_DROP     ///< drop data from the page cache once it has been read, so that other users of the cache are not disturbed
+};
+
 /** @class Fraction
  *  @brief A fraction (i.e. a thing with an integer numerator and an integer denominator).
  */
@@ -240,6 +248,14 @@ enum Standard {
 	SMPTE
 };
 
+/** Implementation to use when decrypting essence */
+enum DecryptionBackend {
+	/** asdcplib's own AES code */
+	DECRYPTION_ASDCPLIB,
+	/** OpenSSL's EVP interface, which uses AES-NI (or similar) where the CPU has it */
+	DECRYPTION_OPENSSL
+};
+
 enum Formulation {
 	MODIFIED_TRANSITIONAL_1,
 	MULTIPLE_MODIFIED_TRANSITIONAL_1,
@@ -42,6 +42,9 @@
 #include "openjpeg_image.h"
 #include "dcp_assert.h"
 #include "compose.hpp"
+#include "mxf_cache.h"
+#include "file_identity.h"
+#include "sequential_reader.h"
 #include <openjpeg.h>
 #include <asdcp/KM_util.h>
 #include <asdcp/KM_fileio.h>
@@ -53,12 +56,18 @@
 #include <libxml++/nodes/element.h>
 #include <libxml++/document.h>
 #include <openssl/sha.h>
+#include <openssl/evp.h>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <stdexcept>
 #include <iostream>
 #include <iomanip>
+#ifdef LIBDCP_POSIX
+#include <time.h>
+#endif
 
 using std::string;
 using std::wstring;
@@ -101,52 +110,120 @@ dcp::make_digest (Data data)
 	return Kumu::base64encode (byte_buffer, SHA_DIGEST_LENGTH, digest, 64);
 }
 
+/** mutex to protect global_read_cache_mode */
+static boost::mutex global_read_cache_mode_mutex;
+static ReadCacheMode global_read_cache_mode = READ_CACHE_KEEP;
+
+/** Set how reads which are given READ_CACHE_DEFAULT should treat the page cache.
+ *  @param mode New mode, which must not be READ_CACHE_DEFAULT.
+ */
+void
+dcp::set_read_cache_mode (ReadCacheMode mode)
+{
+	DCP_ASSERT (mode != READ_CACHE_DEFAULT);
+	boost::mutex::scoped_lock lm (global_read_cache_mode_mutex);
+	global_read_cache_mode = mode;
+}
+
+/** @return Mode used by reads which are given READ_CACHE_DEFAULT */
+ReadCacheMode
+dcp::read_cache_mode ()
+{
+	boost::mutex::scoped_lock lm (global_read_cache_mode_mutex);
+	return global_read_cache_mode;
+}
+
 /** Create a digest for a file.
  *  @param filename File name.
  *  @param progress Optional progress reporting function.  The function will be called
  *  with a progress value between 0 and 1.
+ *  @param mode How the reads of the file should treat the page cache.
+ *  @param limiter Rate limiter for the reads of the file, or 0.
+ *  @param observer Optional function which will be called with the offset, data and size of each
+ *  block of the file as it is read, so that other checks can be made without reading the file again.
+ *  If this is given the digest cache is not used to avoid reading the file.
  *  @return Digest.
  */
 string
-dcp::make_digest (boost::filesystem::path filename, function<void (float)> progress)
+dcp::make_digest (
+	boost::filesystem::path filename,
+	function<void (float)> progress,
+	ReadCacheMode mode,
+	shared_ptr<RateLimiter> limiter,
+	function<void (int64_t, uint8_t const *, int)> observer
+	)
 {
-	Kumu::FileReader reader;
-	Kumu::Result_t r = reader.OpenRead (filename.string().c_str ());
-	if (ASDCP_FAILURE (r)) {
-		boost::throw_exception (FileError ("could not open file to compute digest", filename, r));
+	if (!observer) {
+		optional<string> cached = read_digest_cache (filename);
+		if (cached) {
+			return *cached;
+		}
 	}
 
-	SHA_CTX sha;
-	SHA1_Init (&sha);
+	/* Note the file's identity before we start so that we only cache the digest if
+	   the file did not change while we were reading it.
+	*/
+	optional<FileIdentity> identity;
+	if (digest_cache_directory ()) {
+		try {
+			identity = FileIdentity (filename);
+		} catch (FileError &) {
+			/* We will report this below */
+		}
+	}
 
-	int const buffer_size = 65536;
-	Kumu::ByteString read_buffer (buffer_size);
+	if (mode == READ_CACHE_DEFAULT) {
+		mode = read_cache_mode ();
+	}
 
-	Kumu::fsize_t done = 0;
-	Kumu::fsize_t const size = reader.Size ();
-	while (1) {
-		ui32_t read = 0;
-		Kumu::Result_t r = reader.Read (read_buffer.Data(), read_buffer.Capacity(), &read);
+	SequentialReader reader (filename, mode == READ_CACHE_DROP, 4 * 1024 * 1024, limiter);
 
-		if (r == Kumu::RESULT_ENDOFFILE) {
+#if OPENSSL_VERSION_NUMBER > 0x10100000L
+	shared_ptr<EVP_MD_CTX> context (EVP_MD_CTX_new (), EVP_MD_CTX_free);
+#else
+	shared_ptr<EVP_MD_CTX> context (EVP_MD_CTX_create (), EVP_MD_CTX_destroy);
+#endif
+	if (!context || EVP_DigestInit_ex (context.get(), EVP_sha1(), 0) != 1) {
+		boost::throw_exception (MiscError ("could not set up digest"));
+	}
+
+	int64_t done = 0;
+	int64_t const size = reader.size ();
+	while (true) {
+		uint8_t const * data = 0;
+		int const read = reader.read (&data);
+		if (read == 0) {
 			break;
-		} else if (ASDCP_FAILURE (r)) {
-			boost::throw_exception (FileError ("could not read file to compute digest", filename, r));
 		}
 
-		SHA1_Update (&sha, read_buffer.Data(), read);
+		if (EVP_DigestUpdate (context.get(), data, read) != 1) {
+			boost::throw_exception (MiscError ("could not update digest"));
+		}
+
+		if (observer) {
+			observer (done, data, read);
+		}
 
 		if (progress) {
 			progress (float (done) / size);
-			done += read;
 		}
+
+		done += read;
 	}
 
 	byte_t byte_buffer[SHA_DIGEST_LENGTH];
-	SHA1_Final (byte_buffer, &sha);
+	if (EVP_DigestFinal_ex (context.get(), byte_buffer, 0) != 1) {
+		boost::throw_exception (MiscError ("could not finish digest"));
+	}
 
 	char digest[64];
-	return Kumu::base64encode (byte_buffer, SHA_DIGEST_LENGTH, digest, 64);
+	string const result = Kumu::base64encode (byte_buffer, SHA_DIGEST_LENGTH, digest, 64);
+
+	if (identity) {
+		write_digest_cache (*identity, result);
+	}
+
+	return result;
 }
 
 /** @param s A string.
@@ -376,3 +453,17 @@ dcp::indent (xmlpp::Element* element, int initial)
 		element->add_child_text (last, "\n" + spaces(initial));
 	}
 }
+
+/** @return Current time in microseconds since some arbitrary point, for measuring intervals */
+int64_t
+dcp::monotonic_microseconds ()
+{
+#ifdef LIBDCP_POSIX
+	struct timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return int64_t (t.tv_sec) * 1000000 + t.tv_nsec / 1000;
+#else
+	boost::posix_time::ptime const epoch (boost::gregorian::date (1970, 1, 1));
+	return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds ();
+#endif
+}
@@ -57,14 +57,24 @@ namespace dcp {
 class CertificateChain;
 class GammaLUT;
 class OpenJPEGImage;
+class RateLimiter;
 
 extern std::string make_uuid ();
-extern std::string make_digest (boost::filesystem::path filename, boost::function<void (float)>);
+extern std::string make_digest (
+	boost::filesystem::path filename,
+	boost::function<void (float)>,
+	ReadCacheMode mode = READ_CACHE_DEFAULT,
+	boost::shared_ptr<RateLimiter> limiter = boost::shared_ptr<RateLimiter> (),
+	boost::function<void (int64_t, uint8_t const *, int)> observer = boost::function<void (int64_t, uint8_t const *, int)> ()
+	);
 extern std::string make_digest (Data data);
 extern bool empty_or_white_space (std::string s);
 extern bool ids_equal (std::string a, std::string b);
 extern std::string remove_urn_uuid (std::string raw);
 extern void init ();
+extern void set_read_cache_mode (ReadCacheMode mode);
+extern ReadCacheMode read_cache_mode ();
+extern int64_t monotonic_microseconds ();
 
 extern int base64_decode (std::string const & in, unsigned char* out, int out_length);
 extern boost::optional<boost::filesystem::path> relative_to_root (boost::filesystem::path root, boost::filesystem::path file);
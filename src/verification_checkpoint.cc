@@ -0,0 +1,284 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/verification_checkpoint.cc
+ *  @brief VerificationCheckpoint class.
+ */
+
+#include "verification_checkpoint.h"
+#include "file_identity.h"
+#include "exceptions.h"
+#include "dcp_assert.h"
+#include "compose.hpp"
+#include "util.h"
+#include <boost/foreach.hpp>
+#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <inttypes.h>
+
+using std::string;
+using std::list;
+using std::map;
+using namespace dcp;
+
+/** Start of the first line of checkpoint files of any version */
+static string const checkpoint_magic_prefix = "libdcp-verification-checkpoint-";
+/** First line of checkpoint files of the current version */
+static string const checkpoint_magic = checkpoint_magic_prefix + "2";
+
+/** Read a line, returning false if there is not a complete one */
+static bool
+read_line (std::istream& in, string& line)
+{
+	std::getline (in, line);
+	/* If there was no newline the line was only partly written */
+	return !in.fail() && !in.eof();
+}
+
+/** Open a checkpoint file, reading any entries that it already has.  Any entry which was
+ *  only partly written (because verification was interrupted) is ignored.
+ *  @param file Checkpoint file, which will be created if it does not exist.
+ */
+VerificationCheckpoint::VerificationCheckpoint (boost::filesystem::path file)
+	: _file (file)
+	, _output (0)
+{
+	std::ifstream in (file.string().c_str ());
+	if (in.good ()) {
+		string line;
+		if (!read_line (in, line) || line.find (checkpoint_magic_prefix) != 0) {
+			boost::throw_exception (MiscError (String::compose ("%1 is not a valid verification checkpoint", file.string())));
+		}
+
+		/* Entries from other versions are not used, so those assets will be read again */
+		bool const current = line == checkpoint_magic;
+		while (current && read_line (in, line)) {
+			std::istringstream s (line);
+			s.imbue (std::locale::classic ());
+			string word;
+			Entry entry;
+			int64_t modification_time = 0;
+			int64_t change_time = 0;
+			int notes = 0;
+			s >> word >> entry.size >> modification_time >> entry.modification_time_nsec
+			  >> change_time >> entry.change_time_nsec >> entry.device >> entry.inode >> entry.hash >> entry.checks >> notes;
+			/* The asset's path is the rest of the line after the next space */
+			string path;
+			if (s.fail() || word != "asset" || s.get() != ' ' || !std::getline (s, path) || path.empty()) {
+				break;
+			}
+			entry.modification_time = modification_time;
+			entry.change_time = change_time;
+
+			for (int i = 0; i < notes; ++i) {
+				if (!read_line (in, line)) {
+					break;
+				}
+				std::istringstream n (line);
+				n.imbue (std::locale::classic ());
+				Note note;
+				n >> word >> note.type >> note.code;
+				if (n.fail() || word != "note") {
+					break;
+				}
+				if (n.get() == ' ') {
+					std::getline (n, note.text);
+				}
+				entry.notes.push_back (note);
+			}
+
+			if (int (entry.notes.size()) != notes) {
+				break;
+			}
+
+			_entries[path] = entry;
+		}
+	}
+
+	/* Write the good entries to a new file, so that anything partly written is discarded,
+	   and then carry on adding to that.
+	*/
+	boost::filesystem::path temp = file;
+	temp += ".tmp";
+	FILE* f = fopen_boost (temp, "w");
+	if (!f) {
+		boost::throw_exception (FileError ("could not open verification checkpoint for writing", temp, errno));
+	}
+	fprintf (f, "%s\n", checkpoint_magic.c_str());
+	for (map<string, Entry>::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
+		write (f, i->first, i->second);
+	}
+	fclose (f);
+	boost::filesystem::rename (temp, file);
+
+	_output = fopen_boost (file, "a");
+	if (!_output) {
+		boost::throw_exception (FileError ("could not open verification checkpoint for writing", file, errno));
+	}
+}
+
+VerificationCheckpoint::~VerificationCheckpoint ()
+{
+	if (_output) {
+		fclose (_output);
+	}
+}
+
+void
+VerificationCheckpoint::write (FILE* output, string path, Entry const & entry)
+{
+	fprintf (
+		output, "asset %" PRIuMAX " %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %" PRIu64 " %" PRIu64 " %s %s %d %s\n",
+		entry.size,
+		static_cast<int64_t> (entry.modification_time),
+		entry.modification_time_nsec,
+		static_cast<int64_t> (entry.change_time),
+		entry.change_time_nsec,
+		entry.device,
+		entry.inode,
+		entry.hash.c_str(),
+		entry.checks.c_str(),
+		int (entry.notes.size()),
+		path.c_str()
+		);
+
+	BOOST_FOREACH (Note const & i, entry.notes) {
+		if (i.text.empty ()) {
+			fprintf (output, "note %d %d\n", i.type, i.code);
+		} else {
+			fprintf (output, "note %d %d %s\n", i.type, i.code, i.text.c_str());
+		}
+	}
+}
+
+/** Look for an asset which has already been read.
+ *  @param identity Identity of the asset's file, found before it is read.
+ *  @param checks Description of the checks that are wanted.
+ *  @param file File to give in any notes.
+ *  @param hash Filled in with the asset's hash, if it is found.
+ *  @param notes Filled in with problems found with the asset's frames, if it is found.
+ *  @return true if the asset is unchanged since it was read with the same checks.
+ */
+bool
+VerificationCheckpoint::find (
+	FileIdentity const & identity,
+	string checks,
+	boost::filesystem::path file,
+	string* hash,
+	list<VerificationNote>* notes
+	) const
+{
+	boost::mutex::scoped_lock lm (_mutex);
+
+	map<string, Entry>::const_iterator i = _entries.find (identity.path().string());
+	if (i == _entries.end()) {
+		return false;
+	}
+
+	Entry const & e = i->second;
+	if (e.size != identity.size() ||
+	    e.modification_time != identity.modification_time() ||
+	    e.modification_time_nsec != identity.modification_time_nsec() ||
+	    e.change_time != identity.change_time() ||
+	    e.change_time_nsec != identity.change_time_nsec() ||
+	    e.device != identity.device() ||
+	    e.inode != identity.inode() ||
+	    e.checks != checks) {
+		return false;
+	}
+
+	*hash = e.hash;
+	notes->clear ();
+	BOOST_FOREACH (Note const & j, e.notes) {
+		VerificationNote::Type const type = static_cast<VerificationNote::Type> (j.type);
+		VerificationNote::Code const code = static_cast<VerificationNote::Code> (j.code);
+		if (j.text.empty ()) {
+			notes->push_back (VerificationNote (type, code, file));
+		} else {
+			notes->push_back (VerificationNote (type, code, j.text, file));
+		}
+	}
+
+	return true;
+}
+
+/** Record that an asset has been read.  Nothing is recorded if the asset's file has
+ *  changed since identity was found.
+ *  @param identity Identity of the asset's file, found before it was read.
+ *  @param checks Description of the checks that were made, which must not contain spaces.
+ *  @param hash Hash of the asset.
+ *  @param notes Problems found with the asset's frames.
+ */
+void
+VerificationCheckpoint::add (FileIdentity const & identity, string checks, string hash, list<VerificationNote> const & notes)
+{
+	DCP_ASSERT (!checks.empty() && checks.find(' ') == string::npos);
+
+	try {
+		if (FileIdentity (identity.path()) != identity) {
+			return;
+		}
+	} catch (FileError &) {
+		return;
+	}
+
+	Entry entry;
+	entry.size = identity.size ();
+	entry.modification_time = identity.modification_time ();
+	entry.modification_time_nsec = identity.modification_time_nsec ();
+	entry.change_time = identity.change_time ();
+	entry.change_time_nsec = identity.change_time_nsec ();
+	entry.device = identity.device ();
+	entry.inode = identity.inode ();
+	entry.checks = checks;
+	entry.hash = hash;
+	BOOST_FOREACH (VerificationNote const & i, notes) {
+		Note note;
+		note.type = i.type ();
+		note.code = i.code ();
+		note.text = i.note().get_value_or ("");
+		/* Each note must fit on one line */
+		for (string::iterator j = note.text.begin(); j != note.text.end(); ++j) {
+			if (*j == '\n' || *j == '\r') {
+				*j = ' ';
+			}
+		}
+		entry.notes.push_back (note);
+	}
+
+	boost::mutex::scoped_lock lm (_mutex);
+	_entries[identity.path().string()] = entry;
+	write (_output, identity.path().string(), entry);
+	fflush (_output);
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/verification_checkpoint.h
+ *  @brief VerificationCheckpoint class.
+ */
+
+#ifndef LIBDCP_VERIFICATION_CHECKPOINT_H
+#define LIBDCP_VERIFICATION_CHECKPOINT_H
+
+#include "verify.h"
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+namespace dcp {
+
+class FileIdentity;
+
+/** @class VerificationCheckpoint
+ *  @brief A file recording the assets that have been read by verify(), so that an interrupted
+ *  verification can carry on without reading them again.
+ *
+ *  For each asset the file holds the asset's FileIdentity, a description of the checks that
+ *  were made, the asset's hash and any problems found with its frames.  An entry is written
+ *  (and flushed) as soon as each asset has been read, and it is only used for as long as the
+ *  asset's FileIdentity stays the same and the same checks are asked for.
+ */
+class VerificationCheckpoint : public boost::noncopyable
+{
+public:
+	explicit VerificationCheckpoint (boost::filesystem::path file);
+	~VerificationCheckpoint ();
+
+	bool find (
+		FileIdentity const & identity,
+		std::string checks,
+		boost::filesystem::path file,
+		std::string* hash,
+		std::list<VerificationNote>* notes
+		) const;
+
+	void add (FileIdentity const & identity, std::string checks, std::string hash, std::list<VerificationNote> const & notes);
+
+private:
+	struct Note
+	{
+		Note ()
+			: type (0)
+			, code (0)
+		{}
+
+		int type;
+		int code;
+		std::string text;
+	};
+
+	struct Entry
+	{
+		Entry ()
+			: size (0)
+			, modification_time (0)
+			, modification_time_nsec (0)
+			, change_time (0)
+			, change_time_nsec (0)
+			, device (0)
+			, inode (0)
+		{}
+
+		uintmax_t size;
+		time_t modification_time;
+		int64_t modification_time_nsec;
+		time_t change_time;
+		int64_t change_time_nsec;
+		uint64_t device;
+		uint64_t inode;
+		std::string checks;
+		std::string hash;
+		std::list<Note> notes;
+	};
+
+	static void write (FILE* output, std::string path, Entry const & entry);
+
+	boost::filesystem::path _file;
+	/** mutex to protect _entries and _output */
+	mutable boost::mutex _mutex;
+	/** entries, keyed by the canonical path of the asset */
+	std::map<std::string, Entry> _entries;
+	FILE* _output;
+};
+
+}
+
+#endif
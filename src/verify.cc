@@ -39,8 +39,20 @@
 #include "reel_sound_asset.h"
 #include "exceptions.h"
 #include "compose.hpp"
+#include "hash_assets.h"
+#include "frame_splitter.h"
+#include "stereo_picture_asset.h"
+#include "picture_frame_checker.h"
+#include "verification_checkpoint.h"
+#include "file_identity.h"
+#include "util.h"
+#include "raw_convert.h"
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
 #include <list>
+#include <map>
+#include <set>
 #include <vector>
 #include <iostream>
 
@@ -48,9 +60,12 @@ using std::list;
 using std::vector;
 using std::string;
 using std::cout;
+using std::set;
+using std::map;
 using boost::shared_ptr;
 using boost::optional;
 using boost::function;
+using boost::dynamic_pointer_cast;
 
 using namespace dcp;
 
@@ -60,17 +75,225 @@ enum Result {
 	RESULT_BAD
 };
 
+/** What has been found out by reading assets, which may be filled in by several threads at once */
+struct Scans
+{
+	/** mutex to protect done and frame_notes */
+	boost::mutex mutex;
+	/** assets which have been read by scan_asset() */
+	set<shared_ptr<Asset> > done;
+	/** problems found with the frames of each asset which have not yet been reported */
+	map<shared_ptr<Asset>, list<VerificationNote> > frame_notes;
+	/** first and last frames used by each reel of each picture asset, which are always sampled;
+	 *  this is filled in before any scanning, and not changed after.
+	 */
+	map<shared_ptr<Asset>, set<int64_t> > boundaries;
+	/** record of assets which have been read, or 0 */
+	shared_ptr<VerificationCheckpoint> checkpoint;
+};
+
+static void
+handle_frame (
+	shared_ptr<const PictureAsset> asset,
+	PictureFrameChecker* checker,
+	PictureFrameSampler* sampler,
+	function<void (shared_ptr<const PictureAsset>, int64_t, uint8_t const *, int64_t)> handler,
+	int64_t frame,
+	uint8_t const * data,
+	int64_t size
+	)
+{
+	if (checker) {
+		checker->check (frame, data, size);
+	}
+
+	if (sampler) {
+		sampler->check (frame, data, size);
+	}
+
+	if (handler) {
+		handler (asset, frame, data, size);
+	}
+}
+
+/** @param boundaries Frames of the asset which are always sampled.
+ *  @return Description of the checks that scan_asset() will make on an asset, for a checkpoint.
+ */
+static string
+checks_description (shared_ptr<PictureAsset> picture, VerificationOptions const & options, set<int64_t> const & boundaries)
+{
+	if (!picture) {
+		return "hash";
+	}
+
+	bool const sample = options.sample_fraction > 0 && !picture->encrypted();
+
+	/* The boundaries change the sample, so they must be part of the description */
+	string sampled;
+	if (sample) {
+		BOOST_FOREACH (int64_t i, boundaries) {
+			if (!sampled.empty ()) {
+				sampled += ":";
+			}
+			sampled += raw_convert<string> (i);
+		}
+	}
+
+	return String::compose (
+		"hash,frames=%1,sample=%2,seed=%3,boundaries=%4",
+		options.check_picture_frames ? 1 : 0,
+		sample ? options.sample_fraction : 0,
+		options.sample_seed,
+		sampled.empty() ? "none" : sampled
+		);
+}
+
+/** Read an asset's file to find its hash, giving each of its frames to any frame checks
+ *  on the way so that the file is only read once.  If there is a checkpoint the asset is only
+ *  read if the checkpoint does not have it already.
+ */
+static void
+scan_asset (shared_ptr<Asset> asset, function<void (float)> progress, VerificationOptions const & options, Scans* scans)
+{
+	shared_ptr<PictureAsset> picture = dynamic_pointer_cast<PictureAsset> (asset);
+	list<VerificationNote> notes;
+
+	/* Nothing else changes scans->boundaries now, so we don't need the lock */
+	map<shared_ptr<Asset>, set<int64_t> >::const_iterator b = scans->boundaries.find (asset);
+	set<int64_t> const boundaries = b == scans->boundaries.end() ? set<int64_t> () : b->second;
+
+	optional<FileIdentity> identity;
+	string const checks = checks_description (picture, options, boundaries);
+	if (scans->checkpoint && !(picture && options.picture_frame_handler)) {
+		identity = FileIdentity (asset->file().get());
+		string hash;
+		if (scans->checkpoint->find (*identity, checks, asset->file().get(), &hash, &notes)) {
+			asset->set_hash (hash);
+			boost::mutex::scoped_lock lm (scans->mutex);
+			scans->done.insert (asset);
+			scans->frame_notes[asset] = notes;
+			return;
+		}
+	}
+
+	bool scan_frames = picture && (options.picture_frame_handler || options.check_picture_frames || options.sample_fraction > 0);
+
+	vector<FrameIndexEntry> index;
+	if (scan_frames) {
+		try {
+			index = picture->frame_index ();
+		} catch (DCPReadError& e) {
+			/* We can't find the frames, but we can still check the hash of the whole file */
+			notes.push_back (
+				VerificationNote (
+					VerificationNote::VERIFY_ERROR,
+					VerificationNote::GENERAL_READ,
+					String::compose ("could not read the frame index of %1 (%2)", asset->file()->string(), e.what()),
+					asset->file().get()
+					)
+				);
+			scan_frames = false;
+		}
+	}
+
+	if (!scan_frames) {
+		asset->hash (progress, options.read_cache_mode, options.rate_limiter);
+	} else {
+		shared_ptr<PictureFrameChecker> checker;
+		if (options.check_picture_frames) {
+			checker.reset (
+				new PictureFrameChecker (
+					asset->file().get(), picture->edit_rate(), static_cast<bool> (dynamic_pointer_cast<StereoPictureAsset> (picture)), picture->encrypted()
+					)
+				);
+		}
+
+		shared_ptr<PictureFrameSampler> sampler;
+		if (options.sample_fraction > 0 && !picture->encrypted()) {
+			sampler.reset (
+				new PictureFrameSampler (
+					asset->file().get(),
+					asset->id(),
+					picture->intrinsic_duration(),
+					static_cast<bool> (dynamic_pointer_cast<StereoPictureAsset> (picture)),
+					options.sample_fraction,
+					boundaries,
+					options.sample_seed
+					)
+				);
+		}
+
+		FrameSplitter splitter (
+			index,
+			boost::bind (&handle_frame, picture, checker.get(), sampler.get(), options.picture_frame_handler, _1, _2, _3)
+			);
+
+		asset->set_hash (
+			make_digest (
+				asset->file().get(), progress, options.read_cache_mode, options.rate_limiter,
+				boost::bind (&FrameSplitter::add, &splitter, _1, _2, _3)
+				)
+			);
+
+		if (checker) {
+			notes = checker->notes ();
+		}
+		if (sampler) {
+			/* Frames are handed on in order, so any after the last one that was handed on were
+			   never seen; either the index does not cover them or they run past the end of the file.
+			*/
+			sampler->not_reached (splitter.frames ());
+			list<VerificationNote> s = sampler->notes ();
+			notes.splice (notes.end(), s);
+		}
+	}
+
+	if (identity) {
+		scans->checkpoint->add (*identity, checks, asset->hash(), notes);
+	}
+
+	boost::mutex::scoped_lock lm (scans->mutex);
+	scans->done.insert (asset);
+	scans->frame_notes[asset] = notes;
+}
+
+/** Add any problems with the frames of an asset to a list, unless they have already been added */
+static void
+add_frame_notes (shared_ptr<ReelMXF> reel_mxf, Scans* scans, list<VerificationNote>& notes)
+{
+	boost::mutex::scoped_lock lm (scans->mutex);
+	map<shared_ptr<Asset>, list<VerificationNote> >::iterator i = scans->frame_notes.find (reel_mxf->asset_ref().asset());
+	if (i != scans->frame_notes.end()) {
+		notes.splice (notes.end(), i->second);
+	}
+}
+
 static Result
-verify_asset (shared_ptr<DCP> dcp, shared_ptr<ReelMXF> reel_mxf, function<void (float)> progress)
+verify_asset (
+	shared_ptr<DCP> dcp,
+	shared_ptr<ReelMXF> reel_mxf,
+	function<void (float)> progress,
+	VerificationOptions const & options,
+	Scans* scans
+	)
 {
-	string const actual_hash = reel_mxf->asset_ref()->hash(progress);
+	shared_ptr<Asset> asset = reel_mxf->asset_ref().asset();
+	bool scanned;
+	{
+		boost::mutex::scoped_lock lm (scans->mutex);
+		scanned = scans->done.find(asset) != scans->done.end();
+	}
+
+	if (!scanned) {
+		scan_asset (asset, progress, options, scans);
+	}
+
+	string const actual_hash = asset->hash ();
 
 	list<shared_ptr<PKL> > pkls = dcp->pkls();
 	/* We've read this DCP in so it must have at least one PKL */
 	DCP_ASSERT (!pkls.empty());
 
-	shared_ptr<Asset> asset = reel_mxf->asset_ref().asset();
-
 	optional<string> pkl_hash;
 	BOOST_FOREACH (shared_ptr<PKL> i, pkls) {
 		pkl_hash = i->hash (reel_mxf->asset_ref()->id());
@@ -93,8 +316,65 @@ verify_asset (shared_ptr<DCP> dcp, shared_ptr<ReelMXF> reel_mxf, function<void (
 	return RESULT_GOOD;
 }
 
+static void
+add_checked_asset (shared_ptr<ReelMXF> reel_mxf, list<shared_ptr<Asset> >& assets)
+{
+	try {
+		assets.push_back (reel_mxf->asset_ref().asset());
+	} catch (UnresolvedRefError &) {
+		/* This will be reported when the asset is checked */
+	}
+}
+
+/** Add the assets whose hashes verify() will check to a list */
+static void
+add_checked_assets (shared_ptr<DCP> dcp, list<shared_ptr<Asset> >& assets)
+{
+	BOOST_FOREACH (shared_ptr<CPL> cpl, dcp->cpls()) {
+		BOOST_FOREACH (shared_ptr<Reel> reel, cpl->reels()) {
+			if (reel->main_picture()) {
+				add_checked_asset (reel->main_picture(), assets);
+			}
+			if (reel->main_sound()) {
+				add_checked_asset (reel->main_sound(), assets);
+			}
+		}
+	}
+}
+
+/** Note the first and last frames used by each reel of the picture assets in a DCP */
+static void
+add_reel_boundaries (shared_ptr<DCP> dcp, map<shared_ptr<Asset>, set<int64_t> >& boundaries)
+{
+	BOOST_FOREACH (shared_ptr<CPL> cpl, dcp->cpls()) {
+		BOOST_FOREACH (shared_ptr<Reel> reel, cpl->reels()) {
+			shared_ptr<ReelPictureAsset> picture = reel->main_picture ();
+			if (!picture || !picture->asset_ref().resolved()) {
+				continue;
+			}
+			int64_t const entry = picture->entry_point().get_value_or(0);
+			set<int64_t>& b = boundaries[picture->asset_ref().asset()];
+			b.insert (entry);
+			b.insert (entry + picture->actual_duration() - 1);
+		}
+	}
+}
+
+/** Verify some DCPs.
+ *  @param directories Directories containing the DCPs.
+ *  @param stage Function to call with a description of each stage of the verification, and the file involved (if any).
+ *  @param progress Function to call with progress (from 0 to 1) through the current stage.  If options.jobs is
+ *  greater than 1 this may be called from any thread, but never from two at once.
+ *  @param options Options.
+ *  @return Problems found, in the same order regardless of options.jobs.
+ */
 list<VerificationNote>
-dcp::verify (vector<boost::filesystem::path> directories, function<void (string, optional<boost::filesystem::path>)> stage, function<void (float)> progress)
+dcp::verify (
+	vector<boost::filesystem::path> directories,
+	function<void (string, optional<boost::filesystem::path>)> stage,
+	function<void (float)> progress,
+	VerificationOptions options
+	)
 {
 	list<VerificationNote> notes;
 
@@ -103,16 +383,47 @@ dcp::verify (vector<boost::filesystem::path> directories, function<void (string,
 		dcps.push_back (shared_ptr<DCP> (new DCP (i)));
 	}
 
+	/* Problems found when reading each DCP, in the same order as dcps */
+	list<list<VerificationNote> > read_notes;
 	BOOST_FOREACH (shared_ptr<DCP> dcp, dcps) {
 		stage ("Checking DCP", dcp->directory());
+		read_notes.push_back (list<VerificationNote> ());
 		DCP::ReadErrors errors;
 		try {
 			dcp->read (true, &errors);
 		} catch (DCPReadError& e) {
-			notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::GENERAL_READ, string(e.what())));
+			read_notes.back().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::GENERAL_READ, string(e.what())));
 		} catch (XMLError& e) {
-			notes.push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::GENERAL_READ, string(e.what())));
+			read_notes.back().push_back (VerificationNote(VerificationNote::VERIFY_ERROR, VerificationNote::GENERAL_READ, string(e.what())));
+		}
+	}
+
+	Scans scans;
+
+	if (options.checkpoint) {
+		scans.checkpoint.reset (new VerificationCheckpoint (*options.checkpoint));
+	}
+
+	if (options.sample_fraction > 0) {
+		BOOST_FOREACH (shared_ptr<DCP> dcp, dcps) {
+			add_reel_boundaries (dcp, scans.boundaries);
 		}
+	}
+
+	if (options.jobs > 1) {
+		/* Hash all the assets at once; the checks below will then use the results */
+		stage ("Hashing assets", optional<boost::filesystem::path>());
+		list<shared_ptr<Asset> > assets;
+		BOOST_FOREACH (shared_ptr<DCP> dcp, dcps) {
+			add_checked_assets (dcp, assets);
+		}
+		process_assets (assets, boost::bind (&scan_asset, _1, _2, options, &scans), options.jobs, progress, options.jobs_per_device);
+	}
+
+	list<list<VerificationNote> >::const_iterator read_note = read_notes.begin ();
+	BOOST_FOREACH (shared_ptr<DCP> dcp, dcps) {
+		notes.insert (notes.end(), read_note->begin(), read_note->end());
+		++read_note;
 
 		BOOST_FOREACH (shared_ptr<CPL> cpl, dcp->cpls()) {
 			stage ("Checking CPL", cpl->file());
@@ -141,7 +452,7 @@ dcp::verify (vector<boost::filesystem::path> directories, function<void (string,
 					}
 					/* Check asset */
 					stage ("Checking picture asset hash", reel->main_picture()->asset()->file());
-					Result const r = verify_asset (dcp, reel->main_picture(), progress);
+					Result const r = verify_asset (dcp, reel->main_picture(), progress, options, &scans);
 					switch (r) {
 					case RESULT_BAD:
 						notes.push_back (
@@ -156,10 +467,11 @@ dcp::verify (vector<boost::filesystem::path> directories, function<void (string,
 					default:
 						break;
 					}
+					add_frame_notes (reel->main_picture(), &scans, notes);
 				}
 				if (reel->main_sound()) {
 					stage ("Checking sound asset hash", reel->main_sound()->asset()->file());
-					Result const r = verify_asset (dcp, reel->main_sound(), progress);
+					Result const r = verify_asset (dcp, reel->main_sound(), progress, options, &scans);
 					switch (r) {
 					case RESULT_BAD:
 						notes.push_back (
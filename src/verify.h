@@ -34,15 +34,21 @@
 #ifndef LIBDCP_VERIFY_H
 #define LIBDCP_VERIFY_H
 
+#include "types.h"
 #include <boost/filesystem.hpp>
 #include <boost/function.hpp>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 #include <string>
 #include <list>
 #include <vector>
+#include <stdint.h>
 
 namespace dcp {
 
+class PictureAsset;
+class RateLimiter;
+
 class VerificationNote
 {
 public:
@@ -51,7 +57,9 @@ public:
 	*/
 	enum Type {
 		VERIFY_ERROR,
-		VERIFY_WARNING
+		VERIFY_WARNING,
+		/** Information about how the DCP was checked, which is not a problem */
+		VERIFY_INFO
 	};
 
 	enum Code {
@@ -69,6 +77,28 @@ public:
 		SOUND_HASH_INCORRECT,
 		/** The hash of a main sound is different in the CPL and PKL */
 		PKL_CPL_SOUND_HASHES_DISAGREE,
+		/** Some picture frames are bigger than the DCI maximum bit rate (250Mbit/s, or 125Mbit/s
+		 *  for each eye of a stereoscopic picture) allows.  file contains the picture asset filename.
+		 */
+		PICTURE_FRAME_TOO_LARGE,
+		/** The JPEG2000 codestream of some picture frames could not be read.  file contains the picture asset filename. */
+		INVALID_JPEG2000_CODESTREAM,
+		/** Some picture frames do not use the DCI 2K or 4K JPEG2000 profile, or are too big for their profile.
+		 *  file contains the picture asset filename.
+		 */
+		INVALID_JPEG2000_PROFILE,
+		/** Some picture frames have the wrong number of wavelet decomposition levels for their profile.
+		 *  file contains the picture asset filename.
+		 */
+		INVALID_JPEG2000_RESOLUTION_LEVELS,
+		/** Some picture frames do not use the CPRL progression order.  file contains the picture asset filename. */
+		INVALID_JPEG2000_PROGRESSION_ORDER,
+		/** Some sampled picture frames could not be decoded.  file contains the picture asset filename. */
+		PICTURE_FRAME_DECODE_FAILED,
+		/** A sample of the frames of a picture asset were decoded without problems.  note says how many,
+		 *  and the confidence that this gives; file contains the picture asset filename.
+		 */
+		PICTURE_FRAMES_SAMPLED,
 	};
 
 	VerificationNote (Type type, Code code)
@@ -88,6 +118,13 @@ public:
 		, _file (file)
 	{}
 
+	VerificationNote (Type type, Code code, std::string note, boost::filesystem::path file)
+		: _type (type)
+		, _code (code)
+		, _note (note)
+		, _file (file)
+	{}
+
 	Type type () const {
 		return _type;
 	}
@@ -111,10 +148,61 @@ private:
 	boost::optional<boost::filesystem::path> _file;
 };
 
+/** @struct VerificationOptions
+ *  @brief Options for how verify() should go about its checks.
+ */
+struct VerificationOptions
+{
+	VerificationOptions ()
+		: read_cache_mode (READ_CACHE_DEFAULT)
+		, jobs (1)
+		, jobs_per_device (0)
+		, check_picture_frames (false)
+		, sample_fraction (0)
+		, sample_seed (0)
+	{}
+
+	/** How reads of assets should treat the operating system's page cache */
+	ReadCacheMode read_cache_mode;
+	/** Limiter for the rate at which assets are read, or 0 to read them as fast as possible.
+	 *  The limiter's rate can be changed while verification is running.
+	 */
+	boost::shared_ptr<RateLimiter> rate_limiter;
+	/** Number of assets to hash at the same time */
+	int jobs;
+	/** Maximum number of assets on any one storage device to hash at the same time, or 0 for no limit */
+	int jobs_per_device;
+	/** Function to call with each frame of each picture asset as the asset is read to check its hash,
+	 *  so that other checks can be made on the frames without reading the asset again.  This is given
+	 *  the asset, the index of the frame and the data and size of its KLV packet(s) (both eyes for a
+	 *  stereoscopic asset).  If jobs is greater than 1 it may be called from any thread, but the frames
+	 *  of any one asset are always given in order from one thread.
+	 */
+	boost::function<void (boost::shared_ptr<const PictureAsset>, int64_t, uint8_t const *, int64_t)> picture_frame_handler;
+	/** true to check the size and JPEG2000 codestream header of every picture frame against the
+	 *  DCI specification.  This is done as each asset is hashed, so it does not need any more reading.
+	 */
+	bool check_picture_frames;
+	/** Fraction (from 0 to 1) of the frames of each unencrypted picture asset to decode, or 0 to decode none.
+	 *  The frames are chosen at random from across each asset, and always include the first and last frames
+	 *  of each reel.  Like check_picture_frames this is done as each asset is hashed.
+	 */
+	float sample_fraction;
+	/** Seed for the choice of frames to decode, so that the same choice can be made again */
+	uint32_t sample_seed;
+	/** File in which to record each asset as it is read, or none.  If the file already exists, assets
+	 *  which it says have been read with the same checks, and which have not changed since, are not read
+	 *  again; this lets an interrupted verification carry on from where it stopped.  picture_frame_handler
+	 *  is not called for assets that are skipped, so picture assets are always read if it is set.
+	 */
+	boost::optional<boost::filesystem::path> checkpoint;
+};
+
 std::list<VerificationNote> verify (
 	std::vector<boost::filesystem::path> directories,
 	boost::function<void (std::string, boost::optional<boost::filesystem::path>)> stage,
-	boost::function<void (float)> progress
+	boost::function<void (float)> progress,
+	VerificationOptions options = VerificationOptions ()
 	);
 
 }
@@ -0,0 +1,83 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/writer_stats.h
+ *  @brief WriterStats struct.
+ */
+
+#ifndef LIBDCP_WRITER_STATS_H
+#define LIBDCP_WRITER_STATS_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace dcp {
+
+/** @struct WriterStats
+ *  @brief Statistics about the frames that an AssetWriter has written.
+ */
+struct WriterStats
+{
+	/** Number of buckets in latency_histogram */
+	static int const histogram_buckets = 24;
+
+	WriterStats ()
+		: frames (0)
+		, bytes (0)
+		, write_time (0)
+		, parse_time (0)
+		, latency_histogram (histogram_buckets, 0)
+	{}
+
+	/** Number of frames written; for stereoscopic pictures each eye counts as a frame */
+	int64_t frames;
+	/** Number of bytes written for those frames; for picture assets this includes
+	 *  the KLV and encryption overheads, for others it is just the frame data.
+	 */
+	int64_t bytes;
+	/** Total time spent in asdcplib's WriteFrame, in microseconds.  For encrypted assets this
+	 *  includes encryption and HMAC calculation, which asdcplib does not let us time separately.
+	 */
+	int64_t write_time;
+	/** Total time spent parsing JPEG2000 codestreams, in microseconds (picture assets only) */
+	int64_t parse_time;
+	/** Histogram of the time taken to write each frame (parsing plus writing).
+	 *  Element 0 counts frames which took less than 2 microseconds, and element i > 0 those which took
+	 *  between 2^i and 2^(i + 1) microseconds; the last element also counts anything slower.
+	 */
+	std::vector<int64_t> latency_histogram;
+};
+
+}
+
+#endif
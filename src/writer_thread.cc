@@ -0,0 +1,148 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/writer_thread.cc
+ *  @brief WriterThread class.
+ */
+
+#include "writer_thread.h"
+#include "dcp_assert.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+using boost::function;
+using namespace dcp;
+
+/** @param max_queue_length Maximum number of jobs which can be waiting before add() blocks */
+WriterThread::WriterThread (int max_queue_length)
+	: _max_queue_length (max_queue_length)
+	, _busy (false)
+	, _finishing (false)
+	, _thread (0)
+{
+	DCP_ASSERT (_max_queue_length > 0);
+	_thread = new boost::thread (boost::bind (&WriterThread::thread, this));
+}
+
+/** Run any jobs that are still waiting, then stop the thread.  Any errors
+ *  from those jobs are lost; call drain() first to see them.
+ */
+WriterThread::~WriterThread ()
+{
+	{
+		boost::mutex::scoped_lock lm (_mutex);
+		_finishing = true;
+	}
+
+	_condition.notify_all ();
+	_thread->join ();
+	delete _thread;
+}
+
+/** Throw any error from a job.  _mutex must be held.  The error is kept, so that it is
+ *  thrown again by every later call, since any jobs added after the failure were discarded.
+ */
+void
+WriterThread::rethrow ()
+{
+	if (_error) {
+		boost::rethrow_exception (_error);
+	}
+}
+
+/** Add a job to the end of the queue, blocking if the queue is full */
+void
+WriterThread::add (function<void ()> job)
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	while (static_cast<int> (_queue.size()) >= _max_queue_length && !_error) {
+		_condition.wait (lm);
+	}
+
+	rethrow ();
+
+	_queue.push_back (job);
+	_condition.notify_all ();
+}
+
+/** Wait for all queued jobs to finish, throwing the error from any which failed */
+void
+WriterThread::drain ()
+{
+	boost::mutex::scoped_lock lm (_mutex);
+	while (!_queue.empty() || _busy) {
+		_condition.wait (lm);
+	}
+
+	rethrow ();
+}
+
+void
+WriterThread::thread ()
+{
+	while (true) {
+		boost::mutex::scoped_lock lm (_mutex);
+		while (_queue.empty() && !_finishing) {
+			_condition.wait (lm);
+		}
+
+		if (_queue.empty ()) {
+			return;
+		}
+
+		function<void ()> job = _queue.front ();
+		_queue.pop_front ();
+
+		if (_error) {
+			/* Something has already gone wrong, so don't do anything else */
+			_condition.notify_all ();
+			continue;
+		}
+
+		_busy = true;
+		_condition.notify_all ();
+		lm.unlock ();
+
+		try {
+			job ();
+		} catch (...) {
+			lm.lock ();
+			_error = boost::current_exception ();
+			lm.unlock ();
+		}
+
+		lm.lock ();
+		_busy = false;
+		_condition.notify_all ();
+	}
+}
@@ -0,0 +1,91 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+/** @file  src/writer_thread.h
+ *  @brief WriterThread class.
+ */
+
+#ifndef LIBDCP_WRITER_THREAD_H
+#define LIBDCP_WRITER_THREAD_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <list>
+
+namespace boost {
+	class thread;
+}
+
+namespace dcp {
+
+/** @class WriterThread
+ *  @brief A thread which runs jobs (typically frame writes) in the order that they are given.
+ *
+ *  The queue of jobs is bounded, so add() will block if the thread falls too far behind.
+ *  If a job throws an exception, later jobs are discarded and the exception is thrown
+ *  from the next call to add() or drain(), and from every call after that.
+ */
+class WriterThread : public boost::noncopyable
+{
+public:
+	explicit WriterThread (int max_queue_length);
+	~WriterThread ();
+
+	void add (boost::function<void ()> job);
+	void drain ();
+
+private:
+	void thread ();
+	void rethrow ();
+
+	int _max_queue_length;
+
+	/** mutex to protect _queue, _busy, _finishing and _error */
+	boost::mutex _mutex;
+	boost::condition_variable _condition;
+	std::list<boost::function<void ()> > _queue;
+	/** true if the thread is running a job which it has taken from _queue */
+	bool _busy;
+	/** true if the thread should finish once _queue is empty */
+	bool _finishing;
+	/** first exception thrown by a job, if any */
+	boost::exception_ptr _error;
+	boost::thread* _thread;
+};
+
+}
+
+#endif
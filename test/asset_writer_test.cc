@@ -0,0 +1,265 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "mono_picture_asset.h"
+#include "mono_picture_asset_writer.h"
+#include "sound_asset.h"
+#include "sound_asset_writer.h"
+#include "file.h"
+#include "exceptions.h"
+#include "util.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#ifdef LIBDCP_POSIX
+#include <sys/stat.h>
+#endif
+
+using std::string;
+using std::vector;
+using boost::shared_ptr;
+
+static void
+store_frame_info (vector<dcp::FrameInfo>* infos, dcp::FrameInfo info)
+{
+	infos->push_back (info);
+}
+
+/** Check that an asynchronous picture writer gives the same FrameInfos (via its callback)
+ *  as are found in the frame index of the resulting MXF.
+ */
+BOOST_AUTO_TEST_CASE (async_picture_writer_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/async_picture_writer_test.mxf", false);
+	writer->set_asynchronous (4);
+
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	vector<dcp::FrameInfo> written;
+	for (int i = 0; i < 48; ++i) {
+		writer->write_async (j2c.data (), j2c.size (), boost::bind (&store_frame_info, &written, _1));
+	}
+	writer->finalize ();
+
+	BOOST_CHECK_EQUAL (mp->intrinsic_duration(), 48);
+
+	dcp::MonoPictureAsset check ("build/test/async_picture_writer_test.mxf");
+	vector<dcp::FrameIndexEntry> index = check.frame_index ();
+	BOOST_REQUIRE_EQUAL (index.size(), 48U);
+	BOOST_REQUIRE_EQUAL (written.size(), 48U);
+	for (size_t i = 0; i < index.size(); ++i) {
+		BOOST_CHECK_EQUAL (index[i].offset, static_cast<int64_t> (written[i].offset));
+		BOOST_CHECK_EQUAL (index[i].size, static_cast<int64_t> (written[i].size));
+	}
+}
+
+/** Check that an asynchronous sound writer writes everything, including the padded last frame */
+BOOST_AUTO_TEST_CASE (async_sound_writer_test)
+{
+	shared_ptr<dcp::SoundAsset> ms (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, 2, dcp::SMPTE));
+	shared_ptr<dcp::SoundAssetWriter> writer = ms->start_write ("build/test/async_sound_writer_test.mxf");
+	writer->set_asynchronous (2);
+
+	float left[1500];
+	float right[1500];
+	for (int i = 0; i < 1500; ++i) {
+		left[i] = right[i] = 0;
+	}
+	float* data[2] = { left, right };
+	for (int i = 0; i < 47; ++i) {
+		writer->write (data, 1500);
+	}
+	writer->finalize ();
+
+	/* 47 * 1500 samples is 35.25 frames of 2000 */
+	BOOST_CHECK_EQUAL (ms->intrinsic_duration(), 36);
+	dcp::SoundAsset check ("build/test/async_sound_writer_test.mxf");
+	BOOST_CHECK_EQUAL (check.frame_index().size(), 36U);
+}
+
+static void
+store_indexed_frame_info (vector<std::pair<int, dcp::FrameInfo> >* infos, int index, dcp::FrameInfo info)
+{
+	infos->push_back (std::make_pair (index, info));
+}
+
+/** Write picture frames in reverse order and check that they end up in the right place */
+BOOST_AUTO_TEST_CASE (reorder_picture_writer_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/reorder_picture_writer_test.mxf", false);
+
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	vector<std::pair<int, dcp::FrameInfo> > written;
+	for (int i = 23; i >= 0; --i) {
+		writer->write (i, j2c.data (), j2c.size (), boost::bind (&store_indexed_frame_info, &written, i, _1));
+		BOOST_CHECK_EQUAL (written.size(), i == 0 ? 24U : 0U);
+	}
+	writer->finalize ();
+
+	BOOST_CHECK_EQUAL (mp->intrinsic_duration(), 24);
+
+	dcp::MonoPictureAsset check ("build/test/reorder_picture_writer_test.mxf");
+	vector<dcp::FrameIndexEntry> index = check.frame_index ();
+	BOOST_REQUIRE_EQUAL (index.size(), 24U);
+	BOOST_REQUIRE_EQUAL (written.size(), 24U);
+	for (size_t i = 0; i < index.size(); ++i) {
+		BOOST_CHECK_EQUAL (written[i].first, static_cast<int> (i));
+		BOOST_CHECK_EQUAL (index[i].offset, static_cast<int64_t> (written[i].second.offset));
+	}
+}
+
+/** Check that finalize() complains if an out-of-order frame never arrives */
+BOOST_AUTO_TEST_CASE (reorder_picture_writer_missing_frame_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/reorder_picture_writer_missing_frame_test.mxf", false);
+
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	writer->write (0, j2c.data (), j2c.size ());
+	writer->write (2, j2c.data (), j2c.size ());
+	BOOST_CHECK_THROW (writer->finalize (), dcp::MiscError);
+}
+
+/** @return Number of bytes of disk space allocated to a file, or -1 if this is not known */
+static int64_t
+allocated_bytes (boost::filesystem::path file)
+{
+#ifdef LIBDCP_POSIX
+	struct stat st;
+	if (stat (file.string().c_str(), &st) == 0) {
+		return int64_t (st.st_blocks) * 512;
+	}
+#endif
+	return -1;
+}
+
+/** Check that overestimating the size of a file when preallocating does no harm, and that
+ *  the space which was not needed is released.
+ */
+BOOST_AUTO_TEST_CASE (preallocated_sound_writer_test)
+{
+	shared_ptr<dcp::SoundAsset> ms (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, 2, dcp::SMPTE));
+	shared_ptr<dcp::SoundAssetWriter> writer = ms->start_write ("build/test/preallocated_sound_writer_test.mxf");
+	writer->set_expected_size (64 * 1024 * 1024);
+
+	float left[2000];
+	float right[2000];
+	for (int i = 0; i < 2000; ++i) {
+		left[i] = right[i] = 0;
+	}
+	float* data[2] = { left, right };
+	for (int i = 0; i < 24; ++i) {
+		writer->write (data, 2000);
+	}
+
+	/* Preallocation is only a hint, so it may not have happened on this filesystem */
+	int64_t const before = allocated_bytes ("build/test/preallocated_sound_writer_test.mxf");
+	if (before != -1 && before < 64 * 1024 * 1024) {
+		BOOST_TEST_MESSAGE ("space was not preallocated, so its release cannot be checked");
+	}
+
+	writer->finalize ();
+
+	BOOST_CHECK (boost::filesystem::file_size ("build/test/preallocated_sound_writer_test.mxf") < 1024 * 1024);
+	int64_t const after = allocated_bytes ("build/test/preallocated_sound_writer_test.mxf");
+	if (after != -1) {
+		BOOST_CHECK (after < 1024 * 1024);
+	}
+	dcp::SoundAsset check ("build/test/preallocated_sound_writer_test.mxf");
+	BOOST_CHECK_EQUAL (check.frame_index().size(), 24U);
+}
+
+/** Check that a writer's statistics agree with what it wrote */
+BOOST_AUTO_TEST_CASE (picture_writer_stats_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/picture_writer_stats_test.mxf", false);
+
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	int64_t bytes = 0;
+	for (int i = 0; i < 24; ++i) {
+		bytes += writer->write (j2c.data (), j2c.size ()).size;
+		BOOST_CHECK_EQUAL (writer->stats().frames, i + 1);
+	}
+	writer->finalize ();
+
+	dcp::WriterStats stats = writer->stats ();
+	BOOST_CHECK_EQUAL (stats.frames, 24);
+	BOOST_CHECK_EQUAL (stats.bytes, bytes);
+	BOOST_CHECK (stats.write_time >= 0);
+	BOOST_CHECK (stats.parse_time >= 0);
+	BOOST_REQUIRE_EQUAL (stats.latency_histogram.size(), static_cast<size_t> (dcp::WriterStats::histogram_buckets));
+	int64_t total = 0;
+	for (size_t i = 0; i < stats.latency_histogram.size(); ++i) {
+		total += stats.latency_histogram[i];
+	}
+	BOOST_CHECK_EQUAL (total, 24);
+}
+
+/** Write a short sound asset, optionally asking for its hash on finalize() */
+static shared_ptr<dcp::SoundAsset>
+write_sound_asset (boost::filesystem::path file, bool hash_on_finalize)
+{
+	shared_ptr<dcp::SoundAsset> ms (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, 2, dcp::SMPTE));
+	shared_ptr<dcp::SoundAssetWriter> writer = ms->start_write (file);
+	writer->set_hash_on_finalize (hash_on_finalize);
+
+	float left[2000];
+	float right[2000];
+	for (int i = 0; i < 2000; ++i) {
+		left[i] = right[i] = (i % 100) / 100.0;
+	}
+	float* data[2] = { left, right };
+	for (int i = 0; i < 24; ++i) {
+		writer->write (data, 2000);
+	}
+	writer->finalize ();
+	return ms;
+}
+
+/** Check that a writer can give its asset the file's hash, so that the file need not be read again */
+BOOST_AUTO_TEST_CASE (hash_on_finalize_test)
+{
+	boost::filesystem::path const file = "build/test/hash_on_finalize_test.mxf";
+	shared_ptr<dcp::SoundAsset> ms = write_sound_asset (file, true);
+	string const digest = dcp::make_digest (file, 0);
+
+	/* The asset must use the hash it was given, since the file has gone */
+	boost::filesystem::remove (file);
+	BOOST_CHECK_EQUAL (ms->hash (), digest);
+
+	/* By default the hash is found when it is first asked for */
+	ms = write_sound_asset (file, false);
+	boost::filesystem::remove (file);
+	BOOST_CHECK_THROW (ms->hash (), dcp::FileError);
+}
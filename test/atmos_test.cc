@@ -32,6 +32,9 @@
 */
 
 #include "atmos_asset.h"
+#include "atmos_asset_writer.h"
+#include "atmos_asset_reader.h"
+#include "util.h"
 #include "test.h"
 #include <boost/test/unit_test.hpp>
 #include <iostream>
@@ -44,3 +47,31 @@ BOOST_AUTO_TEST_CASE (atmos_read_test)
 	BOOST_CHECK_EQUAL (a.max_channel_count(), 10);
 	BOOST_CHECK_EQUAL (a.max_object_count(), 118);
 }
+
+/** Write an Atmos asset asynchronously from Data buffers and check that it reads back */
+BOOST_AUTO_TEST_CASE (atmos_write_test)
+{
+	boost::shared_ptr<dcp::AtmosAsset> a (new dcp::AtmosAsset (dcp::Fraction (24, 1), 0, 10, 118, dcp::make_uuid(), 0));
+	boost::shared_ptr<dcp::AtmosAssetWriter> writer = a->start_write ("build/test/atmos_write_test.mxf");
+	writer->set_asynchronous (4);
+
+	for (int i = 0; i < 24; ++i) {
+		dcp::Data frame (1000 + i);
+		for (int j = 0; j < frame.size(); ++j) {
+			frame.data()[j] = (i + j) & 0xff;
+		}
+		writer->write (frame);
+	}
+	writer->finalize ();
+
+	dcp::AtmosAsset check ("build/test/atmos_write_test.mxf");
+	BOOST_CHECK_EQUAL (check.intrinsic_duration(), 24);
+	boost::shared_ptr<dcp::AtmosAssetReader> reader = check.start_read ();
+	for (int i = 0; i < 24; ++i) {
+		boost::shared_ptr<const dcp::AtmosFrame> frame = reader->get_frame (i);
+		BOOST_REQUIRE_EQUAL (frame->size(), 1000 + i);
+		for (int j = 0; j < frame->size(); ++j) {
+			BOOST_REQUIRE_EQUAL (static_cast<int> (frame->data()[j]), (i + j) & 0xff);
+		}
+	}
+}
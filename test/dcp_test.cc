@@ -47,12 +47,20 @@
 #include "reel_stereo_picture_asset.h"
 #include "reel_sound_asset.h"
 #include "reel_atmos_asset.h"
+#include "pkl.h"
+#include "util.h"
+#include "exceptions.h"
+#include "compose.hpp"
 #include <asdcp/KM_util.h>
 #include <sndfile.h>
 #include <boost/test/unit_test.hpp>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
 
 using std::string;
+using std::vector;
 using boost::shared_ptr;
+using boost::dynamic_pointer_cast;
 
 static shared_ptr<dcp::DCP>
 make_simple (boost::filesystem::path path)
@@ -132,6 +140,62 @@ BOOST_AUTO_TEST_CASE (dcp_test1)
 	/* build/test/DCP/dcp_test1 is checked against test/ref/DCP/dcp_test1 by run/tests */
 }
 
+static void
+note_progress (vector<float>* progress, float p)
+{
+	progress->push_back (p);
+}
+
+/** Test hashing of assets in several threads when writing the PKL */
+BOOST_AUTO_TEST_CASE (dcp_parallel_hash_test)
+{
+	shared_ptr<dcp::DCP> d = make_simple ("build/test/DCP/dcp_parallel_hash_test");
+
+	/* Forget any hashes that are already known so that write_xml has to find them */
+	BOOST_FOREACH (shared_ptr<dcp::Asset> i, d->assets()) {
+		if (i->file()) {
+			i->set_file (i->file().get());
+		}
+	}
+
+	vector<float> progress;
+	d->write_xml (dcp::SMPTE, dcp::XMLMetadata(), shared_ptr<const dcp::CertificateChain>(), dcp::NameFormat("%t"), boost::bind (&note_progress, &progress, _1), 4);
+
+	BOOST_REQUIRE (!progress.empty ());
+	BOOST_CHECK_CLOSE (progress.back(), 1, 0.001);
+
+	BOOST_REQUIRE_EQUAL (d->pkls().size(), 1U);
+	shared_ptr<dcp::PKL> pkl = d->pkls().front ();
+	BOOST_FOREACH (shared_ptr<dcp::Asset> i, d->assets()) {
+		if (dynamic_pointer_cast<dcp::CPL> (i)) {
+			continue;
+		}
+		BOOST_REQUIRE (pkl->hash (i->id()));
+		BOOST_CHECK_EQUAL (pkl->hash(i->id()).get(), dcp::make_digest (i->file().get(), 0));
+	}
+}
+
+/** Test that a missing asset file gives the same error when hashing in several threads as in one */
+BOOST_AUTO_TEST_CASE (dcp_parallel_hash_missing_file_test)
+{
+	for (int threads = 1; threads <= 4; threads += 3) {
+		shared_ptr<dcp::DCP> d = make_simple (dcp::String::compose ("build/test/DCP/dcp_parallel_hash_missing_file_test%1", threads));
+		BOOST_FOREACH (shared_ptr<dcp::Asset> i, d->assets()) {
+			if (i->file()) {
+				i->set_file (i->file().get());
+				if (dynamic_pointer_cast<dcp::SoundAsset> (i)) {
+					boost::filesystem::remove (i->file().get());
+				}
+			}
+		}
+
+		BOOST_CHECK_THROW (
+			d->write_xml (dcp::SMPTE, dcp::XMLMetadata(), shared_ptr<const dcp::CertificateChain>(), dcp::NameFormat("%t"), boost::function<void (float)> (), threads),
+			dcp::FileError
+			);
+	}
+}
+
 /** Test creation of a 3D DCP from very simple inputs */
 BOOST_AUTO_TEST_CASE (dcp_test2)
 {
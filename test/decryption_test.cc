@@ -44,10 +44,22 @@
 #include "openjpeg_image.h"
 #include "rgb_xyz.h"
 #include "colour_conversion.h"
+#include "mono_picture_asset_writer.h"
+#include "sound_asset.h"
+#include "sound_asset_writer.h"
+#include "sound_asset_reader.h"
+#include "sound_frame.h"
+#include "file.h"
+#include "key.h"
+#include "aes_decryptor.h"
+#include "exceptions.h"
 #include <boost/test/unit_test.hpp>
 #include <boost/scoped_array.hpp>
+#include <boost/bind.hpp>
+#include <cmath>
 
 using std::pair;
+using std::vector;
 using std::make_pair;
 using boost::dynamic_pointer_cast;
 using boost::shared_ptr;
@@ -122,3 +134,280 @@ BOOST_AUTO_TEST_CASE (failing_kdm_test)
 		dcp::file_to_string ("test/data/private.key")
 		);
 }
+
+/** Read a BER-encoded length from an MXF, moving p past it */
+static uint64_t
+read_ber (vector<uint8_t> const & data, size_t& p)
+{
+	if (data[p] < 0x80) {
+		return data[p++];
+	}
+
+	int const bytes = data[p++] & 0x7f;
+	uint64_t length = 0;
+	for (int i = 0; i < bytes; ++i) {
+		length = (length << 8) | data[p++];
+	}
+	return length;
+}
+
+/** Read an 8-byte item from an encrypted triplet, moving p past it */
+static uint64_t
+read_uint64_item (vector<uint8_t> const & data, size_t& p)
+{
+	BOOST_REQUIRE_EQUAL (read_ber (data, p), 8U);
+	uint64_t value = 0;
+	for (int i = 0; i < 8; ++i) {
+		value = (value << 8) | data[p++];
+	}
+	return value;
+}
+
+/** Make the first byte of padding in the last CBC block of an encrypted picture frame
+ *  decrypt to something other than 0, by changing the ciphertext in the block before it.
+ */
+static void
+corrupt_padding (boost::filesystem::path mxf, int frame)
+{
+	vector<dcp::FrameIndexEntry> index = dcp::MonoPictureAsset(mxf).frame_index ();
+	vector<uint8_t> triplet (index[frame].size);
+	FILE* f = fopen (mxf.string().c_str(), "r+b");
+	BOOST_REQUIRE (f);
+	fseek (f, index[frame].offset, SEEK_SET);
+	BOOST_REQUIRE_EQUAL (fread (&triplet[0], 1, triplet.size(), f), triplet.size());
+
+	/* Key and length of the triplet, then ContextID, PlaintextOffset, SourceKey and SourceLength */
+	size_t p = 16;
+	read_ber (triplet, p);
+	p += read_ber (triplet, p);
+	uint64_t const plaintext_offset = read_uint64_item (triplet, p);
+	p += read_ber (triplet, p);
+	uint64_t const source_length = read_uint64_item (triplet, p);
+
+	/* EncryptedSourceValue: IV, check value, plaintext, then ciphertext */
+	read_ber (triplet, p);
+	uint64_t const ciphertext = source_length - plaintext_offset;
+	uint64_t const leftover = ciphertext % 16;
+	size_t const last_block = p + 32 + plaintext_offset + ciphertext - leftover;
+
+	size_t const target = last_block - 16 + leftover;
+	fseek (f, index[frame].offset + target, SEEK_SET);
+	fputc (triplet[target] ^ 0x01, f);
+	fclose (f);
+}
+
+static void
+ignore_hmac_mismatch (int)
+{
+
+}
+
+/** Check that picture frames decrypted with OpenSSL are the same as those decrypted by asdcplib */
+BOOST_AUTO_TEST_CASE (decryption_backend_picture_test)
+{
+	dcp::Key key;
+
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	mp->set_key (key);
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/decryption_backend_picture_test.mxf", false);
+
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	for (int i = 0; i < 24; ++i) {
+		writer->write (j2c.data (), j2c.size ());
+	}
+	writer->finalize ();
+
+	dcp::MonoPictureAsset check ("build/test/decryption_backend_picture_test.mxf");
+	check.set_key (key);
+
+	shared_ptr<dcp::MonoPictureAssetReader> asdcplib = check.start_read ();
+	shared_ptr<dcp::MonoPictureAssetReader> openssl = check.start_read ();
+	openssl->set_decryption_backend (dcp::DECRYPTION_OPENSSL);
+
+	vector<shared_ptr<const dcp::MonoPictureFrame> > bulk = openssl->get_frames (0, 24);
+	BOOST_REQUIRE_EQUAL (bulk.size(), 24U);
+
+	for (int i = 0; i < 24; ++i) {
+		shared_ptr<const dcp::MonoPictureFrame> a = asdcplib->get_frame (i);
+		shared_ptr<const dcp::MonoPictureFrame> b = openssl->get_frame (i);
+		BOOST_REQUIRE_EQUAL (a->j2k_size(), j2c.size());
+		BOOST_CHECK (memcmp (a->j2k_data(), j2c.data(), j2c.size()) == 0);
+		BOOST_REQUIRE_EQUAL (b->j2k_size(), a->j2k_size());
+		BOOST_CHECK (memcmp (b->j2k_data(), a->j2k_data(), a->j2k_size()) == 0);
+		BOOST_REQUIRE_EQUAL (bulk[i]->j2k_size(), a->j2k_size());
+		BOOST_CHECK (memcmp (bulk[i]->j2k_data(), a->j2k_data(), a->j2k_size()) == 0);
+	}
+
+	/* The wrong key should be noticed */
+	check.set_key (dcp::Key ());
+	shared_ptr<dcp::MonoPictureAssetReader> wrong = check.start_read ();
+	wrong->set_decryption_backend (dcp::DECRYPTION_OPENSSL);
+	BOOST_CHECK_THROW (wrong->get_frame (0), dcp::DCPReadError);
+	BOOST_CHECK_THROW (wrong->get_frames (0, 4), dcp::DCPReadError);
+
+	/* So should a damaged tail, even when HMACs are checked later */
+	boost::filesystem::path const damaged = "build/test/decryption_backend_picture_test_damaged.mxf";
+	boost::filesystem::remove (damaged);
+	boost::filesystem::copy_file ("build/test/decryption_backend_picture_test.mxf", damaged);
+	corrupt_padding (damaged, 7);
+
+	dcp::MonoPictureAsset check_damaged (damaged);
+	check_damaged.set_key (key);
+	BOOST_CHECK_THROW (check_damaged.start_read()->get_frame (7), dcp::DCPReadError);
+	shared_ptr<dcp::MonoPictureAssetReader> damaged_openssl = check_damaged.start_read ();
+	damaged_openssl->set_decryption_backend (dcp::DECRYPTION_OPENSSL);
+	BOOST_CHECK_THROW (damaged_openssl->get_frame (7), dcp::DCPReadError);
+	shared_ptr<dcp::MonoPictureAssetReader> damaged_deferred = check_damaged.start_read ();
+	damaged_deferred->set_deferred_hmac_check (boost::bind (&ignore_hmac_mismatch, _1));
+	BOOST_CHECK_EQUAL (damaged_deferred->get_frame(6)->j2k_size(), j2c.size());
+	BOOST_CHECK_THROW (damaged_deferred->get_frame (7), dcp::DCPReadError);
+	damaged_deferred->flush_hmac_checks ();
+}
+
+/** Check that sound frames decrypted with OpenSSL are the same as those decrypted by asdcplib */
+BOOST_AUTO_TEST_CASE (decryption_backend_sound_test)
+{
+	dcp::Key key;
+
+	shared_ptr<dcp::SoundAsset> ms (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, 2, dcp::SMPTE));
+	ms->set_key (key);
+	shared_ptr<dcp::SoundAssetWriter> writer = ms->start_write ("build/test/decryption_backend_sound_test.mxf");
+
+	float left[2000];
+	float right[2000];
+	for (int i = 0; i < 2000; ++i) {
+		left[i] = sin (i * 0.01) * 0.5;
+		right[i] = cos (i * 0.01) * 0.5;
+	}
+	float* data[2] = { left, right };
+	for (int i = 0; i < 24; ++i) {
+		writer->write (data, 2000);
+	}
+	writer->finalize ();
+
+	dcp::SoundAsset check ("build/test/decryption_backend_sound_test.mxf");
+	check.set_key (key);
+
+	shared_ptr<dcp::SoundAssetReader> asdcplib = check.start_read ();
+	shared_ptr<dcp::SoundAssetReader> openssl = check.start_read ();
+	openssl->set_decryption_backend (dcp::DECRYPTION_OPENSSL);
+
+	vector<shared_ptr<const dcp::SoundFrame> > bulk = openssl->get_frames (0, 24);
+	BOOST_REQUIRE_EQUAL (bulk.size(), 24U);
+
+	for (int i = 0; i < 24; ++i) {
+		shared_ptr<const dcp::SoundFrame> a = asdcplib->get_frame (i);
+		shared_ptr<const dcp::SoundFrame> b = openssl->get_frame (i);
+		BOOST_REQUIRE_EQUAL (b->size(), a->size());
+		BOOST_CHECK (memcmp (b->data(), a->data(), a->size()) == 0);
+		BOOST_REQUIRE_EQUAL (bulk[i]->size(), a->size());
+		BOOST_CHECK (memcmp (bulk[i]->data(), a->data(), a->size()) == 0);
+	}
+}
+
+/** Check that decryptors are shared between users of the same key */
+BOOST_AUTO_TEST_CASE (decryptor_sharing_test)
+{
+	dcp::Key key_A;
+	dcp::Key key_B;
+
+	shared_ptr<const dcp::AESDecryptor> a = dcp::AESDecryptor::get (key_A, dcp::SMPTE);
+	shared_ptr<const dcp::AESDecryptor> b = dcp::AESDecryptor::get (key_A, dcp::SMPTE);
+	shared_ptr<const dcp::AESDecryptor> c = dcp::AESDecryptor::get (key_B, dcp::SMPTE);
+	shared_ptr<const dcp::AESDecryptor> d = dcp::AESDecryptor::get (key_A, dcp::INTEROP);
+
+	BOOST_CHECK (a == b);
+	BOOST_CHECK (a != c);
+	BOOST_CHECK (a != d);
+}
+
+static vector<int> hmac_mismatches;
+
+static void
+note_hmac_mismatch (int frame)
+{
+	hmac_mismatches.push_back (frame);
+}
+
+/** Write an encrypted picture asset of 24 frames, with some of the ciphertext of frame 5 corrupted */
+static void
+write_corrupted_asset (boost::filesystem::path mxf, dcp::Key key)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	mp->set_key (key);
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write (mxf, false);
+
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	for (int i = 0; i < 24; ++i) {
+		writer->write (j2c.data (), j2c.size ());
+	}
+	writer->finalize ();
+
+	vector<dcp::FrameIndexEntry> index = dcp::MonoPictureAsset(mxf).frame_index ();
+	FILE* f = fopen (mxf.string().c_str(), "r+b");
+	BOOST_REQUIRE (f);
+	fseek (f, index[5].offset + index[5].size - 100, SEEK_SET);
+	int const c = fgetc (f);
+	fseek (f, index[5].offset + index[5].size - 100, SEEK_SET);
+	fputc (c ^ 0xff, f);
+	fclose (f);
+}
+
+/** Check that deferred HMAC checks notice a corrupted frame without stopping it being read */
+BOOST_AUTO_TEST_CASE (deferred_hmac_check_test)
+{
+	dcp::Key key;
+	write_corrupted_asset ("build/test/deferred_hmac_check_test.mxf", key);
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+
+	dcp::MonoPictureAsset check ("build/test/deferred_hmac_check_test.mxf");
+	check.set_key (key);
+
+	/* Checking inline should fail the read */
+	BOOST_CHECK_THROW (check.start_read()->get_frame (5), dcp::DCPReadError);
+
+	/* Checking later should give all the frames and then report the bad one */
+	hmac_mismatches.clear ();
+	shared_ptr<dcp::MonoPictureAssetReader> reader = check.start_read ();
+	reader->set_deferred_hmac_check (boost::bind (&note_hmac_mismatch, _1));
+	for (int i = 0; i < 24; ++i) {
+		BOOST_CHECK_EQUAL (reader->get_frame(i)->j2k_size(), j2c.size());
+	}
+	reader->flush_hmac_checks ();
+
+	BOOST_REQUIRE_EQUAL (hmac_mismatches.size(), 1U);
+	BOOST_CHECK_EQUAL (hmac_mismatches.front(), 5);
+}
+
+static void
+throw_on_hmac_mismatch (int)
+{
+	boost::throw_exception (dcp::MiscError ("HMAC mismatch"));
+}
+
+/** Check that an exception from a deferred HMAC mismatch handler is thrown to the reader's caller */
+BOOST_AUTO_TEST_CASE (deferred_hmac_check_exception_test)
+{
+	dcp::Key key;
+	write_corrupted_asset ("build/test/deferred_hmac_check_exception_test.mxf", key);
+
+	dcp::MonoPictureAsset check ("build/test/deferred_hmac_check_exception_test.mxf");
+	check.set_key (key);
+
+	shared_ptr<dcp::MonoPictureAssetReader> reader = check.start_read ();
+	reader->set_deferred_hmac_check (boost::bind (&throw_on_hmac_mismatch, _1));
+	/* The handler's exception may come from a later read, depending on how far behind the checks are */
+	for (int i = 0; i < 24; ++i) {
+		try {
+			reader->get_frame (i);
+		} catch (dcp::MiscError &) {
+			BOOST_CHECK (i > 5);
+			break;
+		}
+	}
+
+	BOOST_CHECK_THROW (reader->flush_hmac_checks (), dcp::MiscError);
+	/* It is thrown again by everything after that */
+	BOOST_CHECK_THROW (reader->get_frame (0), dcp::MiscError);
+	BOOST_CHECK_THROW (reader->flush_hmac_checks (), dcp::MiscError);
+}
@@ -0,0 +1,136 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "mono_picture_asset.h"
+#include "mono_picture_asset_writer.h"
+#include "sound_asset.h"
+#include "sound_asset_writer.h"
+#include "file.h"
+#include "frame_splitter.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <cstring>
+
+using std::vector;
+using boost::shared_ptr;
+
+/** Check that the frame index read from a picture MXF agrees with what was written */
+BOOST_AUTO_TEST_CASE (frame_index_picture_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/frame_index_picture_test.mxf", false);
+
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	vector<dcp::FrameInfo> written;
+	for (int i = 0; i < 24; ++i) {
+		written.push_back (writer->write (j2c.data (), j2c.size ()));
+	}
+	writer->finalize ();
+
+	dcp::MonoPictureAsset check ("build/test/frame_index_picture_test.mxf");
+	vector<dcp::FrameIndexEntry> index = check.frame_index ();
+	BOOST_REQUIRE_EQUAL (index.size(), written.size());
+	for (size_t i = 0; i < index.size(); ++i) {
+		BOOST_CHECK_EQUAL (index[i].offset, static_cast<int64_t> (written[i].offset));
+		BOOST_CHECK_EQUAL (index[i].size, static_cast<int64_t> (written[i].size));
+	}
+}
+
+/** Check that we get a sensible frame index from a sound MXF */
+BOOST_AUTO_TEST_CASE (frame_index_sound_test)
+{
+	shared_ptr<dcp::SoundAsset> ms (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, 2, dcp::SMPTE));
+	shared_ptr<dcp::SoundAssetWriter> writer = ms->start_write ("build/test/frame_index_sound_test.mxf");
+
+	float left[2000];
+	float right[2000];
+	for (int i = 0; i < 2000; ++i) {
+		left[i] = right[i] = 0;
+	}
+	float* data[2] = { left, right };
+	for (int i = 0; i < 48; ++i) {
+		writer->write (data, 2000);
+	}
+	writer->finalize ();
+
+	dcp::SoundAsset check ("build/test/frame_index_sound_test.mxf");
+	vector<dcp::FrameIndexEntry> index = check.frame_index ();
+	BOOST_REQUIRE_EQUAL (index.size(), 48U);
+	for (size_t i = 1; i < index.size(); ++i) {
+		BOOST_CHECK_EQUAL (index[i].offset, index[i - 1].offset + index[i - 1].size);
+		/* 2000 samples of 2 channels of 24-bit, plus the KLV key and length */
+		BOOST_CHECK (index[i].size >= 2000 * 2 * 3);
+	}
+}
+
+static void
+collect_frame (vector<vector<uint8_t> >* frames, int64_t index, uint8_t const * data, int64_t size)
+{
+	BOOST_REQUIRE_EQUAL (index, static_cast<int64_t> (frames->size()));
+	frames->push_back (vector<uint8_t> (data, data + size));
+}
+
+/** Check that FrameSplitter picks the frames out of an MXF whatever size of block it is given */
+BOOST_AUTO_TEST_CASE (frame_splitter_test)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write ("build/test/frame_splitter_test.mxf", false);
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	for (int i = 0; i < 24; ++i) {
+		writer->write (j2c.data (), j2c.size ());
+	}
+	writer->finalize ();
+
+	dcp::MonoPictureAsset check ("build/test/frame_splitter_test.mxf");
+	vector<dcp::FrameIndexEntry> index = check.frame_index ();
+	dcp::File mxf ("build/test/frame_splitter_test.mxf");
+
+	int const block_sizes[] = { 1, 7, 4096, int (mxf.size()) };
+	for (size_t i = 0; i < sizeof (block_sizes) / sizeof (int); ++i) {
+		vector<vector<uint8_t> > frames;
+		dcp::FrameSplitter splitter (index, boost::bind (&collect_frame, &frames, _1, _2, _3));
+		for (int64_t offset = 0; offset < mxf.size(); offset += block_sizes[i]) {
+			int const size = std::min (static_cast<int64_t> (block_sizes[i]), mxf.size() - offset);
+			splitter.add (offset, mxf.data() + offset, size);
+		}
+
+		BOOST_CHECK_EQUAL (splitter.frames(), 24);
+		BOOST_REQUIRE_EQUAL (frames.size(), index.size());
+		for (size_t j = 0; j < frames.size(); ++j) {
+			BOOST_REQUIRE_EQUAL (static_cast<int64_t> (frames[j].size()), index[j].size);
+			/* The frame's KLV packet ends with the J2K codestream */
+			BOOST_REQUIRE (frames[j].size() >= j2c.size());
+			BOOST_CHECK (memcmp (&frames[j][frames[j].size() - j2c.size()], j2c.data(), j2c.size()) == 0);
+		}
+	}
+}
@@ -33,9 +33,11 @@
 
 #include "data.h"
 #include "util.h"
+#include "sequential_reader.h"
 #include <boost/bind.hpp>
 #include <boost/test/unit_test.hpp>
 #include <sys/time.h>
+#include <cstring>
 
 void progress (float)
 {
@@ -58,3 +60,54 @@ BOOST_AUTO_TEST_CASE (make_digest_test)
 	/* Hash it */
 	BOOST_CHECK_EQUAL (dcp::make_digest ("build/test/random", boost::bind (&progress, _1)), "GKbk/V3fcRtP5MaPdSmAGNbKkaU=");
 }
+
+/** Check that digests of files agree with those of the same data in memory, for sizes
+ *  around the size of the blocks that make_digest reads.
+ */
+BOOST_AUTO_TEST_CASE (make_digest_block_boundary_test)
+{
+	int const block = 4 * 1024 * 1024;
+	int const sizes[] = { 0, 1, block - 1, block, block + 1, block * 2, block * 3 + 17 };
+
+	srand (2);
+	for (size_t i = 0; i < sizeof (sizes) / sizeof (int); ++i) {
+		dcp::Data data (sizes[i]);
+		uint8_t* p = data.data().get();
+		for (int j = 0; j < sizes[i]; ++j) {
+			*p++ = rand() & 0xff;
+		}
+		data.write ("build/test/make_digest_block_boundary_test");
+		BOOST_CHECK_EQUAL (dcp::make_digest ("build/test/make_digest_block_boundary_test", 0), dcp::make_digest (data));
+	}
+}
+
+/** Check that SequentialReader gives back the whole of a file when its blocks do not divide the file's size */
+BOOST_AUTO_TEST_CASE (sequential_reader_test)
+{
+	int const N = 100003;
+	dcp::Data data (N);
+	uint8_t* p = data.data().get();
+	for (int i = 0; i < N; ++i) {
+		*p++ = i & 0xff;
+	}
+	data.write ("build/test/sequential_reader_test");
+
+	dcp::SequentialReader reader ("build/test/sequential_reader_test", false, 4096);
+	BOOST_CHECK_EQUAL (reader.size(), N);
+
+	int done = 0;
+	while (true) {
+		uint8_t const * block = 0;
+		int const read = reader.read (&block);
+		if (read == 0) {
+			break;
+		}
+		BOOST_REQUIRE (done + read <= N);
+		BOOST_REQUIRE_EQUAL (memcmp (block, data.data().get() + done, read), 0);
+		done += read;
+	}
+
+	BOOST_CHECK_EQUAL (done, N);
+	uint8_t const * block = 0;
+	BOOST_CHECK_EQUAL (reader.read (&block), 0);
+}
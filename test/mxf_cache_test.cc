@@ -0,0 +1,154 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "mono_picture_asset.h"
+#include "mono_picture_asset_writer.h"
+#include "mxf_cache.h"
+#include "file.h"
+#include "util.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+
+using std::string;
+using std::vector;
+using boost::shared_ptr;
+using boost::optional;
+
+static void
+write_picture (boost::filesystem::path file, int frames)
+{
+	shared_ptr<dcp::MonoPictureAsset> mp (new dcp::MonoPictureAsset (dcp::Fraction (24, 1), dcp::SMPTE));
+	shared_ptr<dcp::PictureAssetWriter> writer = mp->start_write (file, false);
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	for (int i = 0; i < frames; ++i) {
+		writer->write (j2c.data (), j2c.size ());
+	}
+	writer->finalize ();
+}
+
+/** Check that details of a picture MXF come back the same from the MXF cache, and that
+ *  the cache is not used when the MXF changes.
+ */
+BOOST_AUTO_TEST_CASE (mxf_cache_test)
+{
+	boost::filesystem::path const dir = "build/test/mxf_cache_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+	boost::filesystem::path const mxf = dir / "video.mxf";
+
+	write_picture (mxf, 24);
+
+	dcp::set_mxf_cache_directory (dir / "cache");
+
+	dcp::MonoPictureAsset first (mxf);
+	vector<dcp::FrameIndexEntry> first_index = first.frame_index ();
+	BOOST_CHECK (dcp::read_mxf_cache (mxf, "descriptor"));
+	BOOST_CHECK (dcp::read_mxf_cache (mxf, "index"));
+
+	/* This should come from the cache */
+	dcp::MonoPictureAsset second (mxf);
+	BOOST_CHECK_EQUAL (second.id(), first.id());
+	BOOST_CHECK (second.size() == first.size());
+	BOOST_CHECK_EQUAL (second.edit_rate(), first.edit_rate());
+	BOOST_CHECK_EQUAL (second.intrinsic_duration(), first.intrinsic_duration());
+	BOOST_CHECK_EQUAL (second.frame_rate(), first.frame_rate());
+	BOOST_CHECK_EQUAL (second.screen_aspect_ratio(), first.screen_aspect_ratio());
+	BOOST_CHECK (second.standard() == first.standard());
+	vector<dcp::FrameIndexEntry> second_index = second.frame_index ();
+	BOOST_REQUIRE_EQUAL (second_index.size(), first_index.size());
+	for (size_t i = 0; i < first_index.size(); ++i) {
+		BOOST_CHECK_EQUAL (second_index[i].offset, first_index[i].offset);
+		BOOST_CHECK_EQUAL (second_index[i].size, first_index[i].size);
+	}
+
+	/* Rewriting the MXF should make the cache miss */
+	write_picture (mxf, 12);
+	BOOST_CHECK (!dcp::read_mxf_cache (mxf, "descriptor"));
+	dcp::MonoPictureAsset third (mxf);
+	BOOST_CHECK_EQUAL (third.intrinsic_duration(), 12);
+	BOOST_CHECK_EQUAL (third.frame_index().size(), 12U);
+
+	dcp::set_mxf_cache_directory (optional<boost::filesystem::path> ());
+}
+
+/** Check that make_digest uses the digest cache for unchanged files, and not for
+ *  files which have changed.
+ */
+BOOST_AUTO_TEST_CASE (digest_cache_test)
+{
+	boost::filesystem::path const dir = "build/test/digest_cache_test";
+	boost::filesystem::remove_all (dir);
+	boost::filesystem::create_directories (dir);
+	boost::filesystem::path const file = dir / "file";
+
+	FILE* f = fopen (file.string().c_str(), "w");
+	BOOST_REQUIRE (f);
+	fprintf (f, "Hello world");
+	fclose (f);
+
+	string const original = dcp::make_digest (file, 0);
+	BOOST_CHECK (!dcp::read_digest_cache (file));
+
+	dcp::set_digest_cache_directory (dir / "cache");
+
+	BOOST_CHECK_EQUAL (dcp::make_digest (file, 0), original);
+	BOOST_REQUIRE (dcp::read_digest_cache (file));
+	BOOST_CHECK_EQUAL (dcp::read_digest_cache(file).get(), original);
+
+#ifdef LIBDCP_POSIX
+	/* Change the contents without changing the size or modification time (to the second);
+	   the cache should still see this from the file's nanosecond times.
+	*/
+	std::time_t const time = boost::filesystem::last_write_time (file);
+	f = fopen (file.string().c_str(), "w");
+	BOOST_REQUIRE (f);
+	fprintf (f, "Hello there");
+	fclose (f);
+	boost::filesystem::last_write_time (file, time);
+	BOOST_CHECK (!dcp::read_digest_cache (file));
+	BOOST_CHECK (dcp::make_digest (file, 0) != original);
+#endif
+
+	/* Changing the size should make the cache miss */
+	f = fopen (file.string().c_str(), "w");
+	BOOST_REQUIRE (f);
+	fprintf (f, "Hello there world");
+	fclose (f);
+	BOOST_CHECK (!dcp::read_digest_cache (file));
+	string const changed = dcp::make_digest (file, 0);
+	BOOST_CHECK (changed != original);
+	BOOST_REQUIRE (dcp::read_digest_cache (file));
+	BOOST_CHECK_EQUAL (dcp::read_digest_cache(file).get(), changed);
+
+	dcp::set_digest_cache_directory (optional<boost::filesystem::path> ());
+}
@@ -0,0 +1,82 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "rate_limiter.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <sys/time.h>
+
+static double
+seconds ()
+{
+	struct timeval t;
+	gettimeofday (&t, 0);
+	return t.tv_sec + t.tv_usec / 1e6;
+}
+
+static void
+take (dcp::RateLimiter* limiter, int64_t bytes)
+{
+	limiter->take (bytes);
+}
+
+/** Check that RateLimiter holds readers to its rate, and that changing the rate wakes them up */
+BOOST_AUTO_TEST_CASE (rate_limiter_test)
+{
+	/* Without a limit nothing should block */
+	dcp::RateLimiter unlimited;
+	double start = seconds ();
+	for (int i = 0; i < 100; ++i) {
+		unlimited.take (1000000000);
+	}
+	BOOST_CHECK (seconds() - start < 0.5);
+
+	/* 5MB at 10MB/s, less the 2.5MB burst, should take at least 0.25s */
+	dcp::RateLimiter limited (10000000);
+	start = seconds ();
+	for (int i = 0; i < 5; ++i) {
+		limited.take (1000000);
+	}
+	BOOST_CHECK (seconds() - start > 0.2);
+
+	/* This would take 1000s, unless we remove the limit while it is waiting */
+	dcp::RateLimiter slow (1000);
+	boost::thread thread (boost::bind (&take, &slow, 1000000));
+	boost::this_thread::sleep (boost::posix_time::milliseconds (100));
+	start = seconds ();
+	slow.set_rate (0);
+	thread.join ();
+	BOOST_CHECK (seconds() - start < 0.5);
+	BOOST_CHECK_EQUAL (slow.rate(), 0);
+}
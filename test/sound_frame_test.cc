@@ -36,9 +36,14 @@
 #include "sound_frame.h"
 #include "sound_asset.h"
 #include "sound_asset_reader.h"
+#include "sound_asset_writer.h"
+#include "sound_range_reader.h"
 #include "exceptions.h"
+#include "raw_convert.h"
 #include <sndfile.h>
+#include <cmath>
 
+using std::vector;
 using boost::shared_ptr;
 
 BOOST_AUTO_TEST_CASE (sound_frame_test)
@@ -87,3 +92,233 @@ BOOST_AUTO_TEST_CASE (sound_frame_test2)
 
 	BOOST_CHECK_THROW (asset.start_read()->get_frame (99999999), dcp::DCPReadError);
 }
+
+/** Check the bulk conversions from a SoundFrame to planar samples */
+BOOST_AUTO_TEST_CASE (sound_frame_planar_test)
+{
+	int const channels = 6;
+	int const samples = 2000;
+
+	shared_ptr<dcp::SoundAsset> ms (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, channels, dcp::SMPTE));
+	shared_ptr<dcp::SoundAssetWriter> writer = ms->start_write ("build/test/sound_frame_planar_test.mxf");
+
+	float in[channels][samples];
+	float* in_pointers[channels];
+	for (int i = 0; i < channels; ++i) {
+		for (int j = 0; j < samples; ++j) {
+			/* Positive and negative values, different in each channel */
+			in[i][j] = (j - samples / 2) * (i + 1) / float (samples * channels);
+		}
+		in_pointers[i] = in[i];
+	}
+	writer->write (in_pointers, samples);
+	writer->finalize ();
+
+	dcp::SoundAsset check ("build/test/sound_frame_planar_test.mxf");
+	shared_ptr<const dcp::SoundFrame> frame = check.start_read()->get_frame (0);
+	BOOST_REQUIRE_EQUAL (frame->channels(), channels);
+	BOOST_REQUIRE_EQUAL (frame->samples(), samples);
+
+	int32_t ints[channels][samples];
+	int32_t* int_pointers[channels];
+	float floats[channels][samples];
+	float* float_pointers[channels];
+	for (int i = 0; i < channels; ++i) {
+		int_pointers[i] = ints[i];
+		float_pointers[i] = floats[i];
+	}
+
+	frame->get (int_pointers);
+	frame->get (float_pointers);
+
+	for (int i = 0; i < channels; ++i) {
+		for (int j = 0; j < samples; ++j) {
+			int32_t s = frame->get (i, j);
+			if (s & 0x800000) {
+				s -= (1 << 24);
+			}
+			BOOST_REQUIRE_EQUAL (ints[i][j], s);
+			BOOST_REQUIRE (fabs (floats[i][j] - in[i][j]) <= 1.0 / (1 << 23));
+		}
+	}
+
+	/* Take channels 4 and 1 */
+	vector<int> subset;
+	subset.push_back (4);
+	subset.push_back (1);
+
+	int32_t subset_ints[2][samples];
+	int32_t* subset_int_pointers[2] = { subset_ints[0], subset_ints[1] };
+	float subset_floats[2][samples];
+	float* subset_float_pointers[2] = { subset_floats[0], subset_floats[1] };
+
+	frame->get (subset, subset_int_pointers);
+	frame->get (subset, subset_float_pointers);
+
+	for (int j = 0; j < samples; ++j) {
+		BOOST_REQUIRE_EQUAL (subset_ints[0][j], ints[4][j]);
+		BOOST_REQUIRE_EQUAL (subset_ints[1][j], ints[1][j]);
+		BOOST_REQUIRE_EQUAL (subset_floats[0][j], floats[4][j]);
+		BOOST_REQUIRE_EQUAL (subset_floats[1][j], floats[1][j]);
+	}
+}
+
+/** Value that sound_range_reader_test writes for a sample, as a multiple of 2^-23 */
+static int32_t
+range_test_sample (int64_t sample, int channel)
+{
+	return ((sample * 7 + channel * 1000) % 65536 - 32768) * 128;
+}
+
+/** Check reading ranges of samples which cross frame boundaries */
+BOOST_AUTO_TEST_CASE (sound_range_reader_test)
+{
+	int const rates[] = { 48000, 96000 };
+	int const channels = 3;
+	int const frames = 10;
+
+	for (int r = 0; r < 2; ++r) {
+		int const samples_per_frame = rates[r] / 24;
+
+		boost::filesystem::path file = "build/test/sound_range_reader_test_" + dcp::raw_convert<std::string> (rates[r]) + ".mxf";
+		shared_ptr<dcp::SoundAsset> ms (new dcp::SoundAsset (dcp::Fraction (24, 1), rates[r], channels, dcp::SMPTE));
+		shared_ptr<dcp::SoundAssetWriter> writer = ms->start_write (file);
+
+		vector<float> in[channels];
+		float* in_pointers[channels];
+		for (int i = 0; i < channels; ++i) {
+			in[i].resize (samples_per_frame);
+			in_pointers[i] = &in[i][0];
+		}
+
+		for (int i = 0; i < frames; ++i) {
+			for (int j = 0; j < channels; ++j) {
+				for (int k = 0; k < samples_per_frame; ++k) {
+					in[j][k] = range_test_sample (int64_t (i) * samples_per_frame + k, j) / float (1 << 23);
+				}
+			}
+			writer->write (in_pointers, samples_per_frame);
+		}
+		writer->finalize ();
+
+		dcp::SoundAsset check (file);
+		shared_ptr<dcp::SoundRangeReader> reader = check.start_range_read ();
+		BOOST_REQUIRE_EQUAL (reader->length(), int64_t (frames) * samples_per_frame);
+
+		/* Some ranges inside frames, across one boundary and across several */
+		int64_t const starts[] = { 0, 5, samples_per_frame - 3, samples_per_frame * 2 + 17, 1 };
+		int const lengths[] = { 1, 100, 6, samples_per_frame * 5 + 3, frames * samples_per_frame - 1 };
+
+		for (int i = 0; i < 5; ++i) {
+			vector<int32_t> out[channels];
+			int32_t* out_pointers[channels];
+			for (int j = 0; j < channels; ++j) {
+				out[j].resize (lengths[i]);
+				out_pointers[j] = &out[j][0];
+			}
+
+			reader->read (starts[i], lengths[i], out_pointers);
+
+			for (int j = 0; j < channels; ++j) {
+				for (int k = 0; k < lengths[i]; ++k) {
+					BOOST_REQUIRE_EQUAL (out[j][k], range_test_sample (starts[i] + k, j));
+				}
+			}
+		}
+
+		/* Just channel 2, as floats */
+		vector<int> subset;
+		subset.push_back (2);
+		vector<float> out (samples_per_frame * 2);
+		float* out_pointer = &out[0];
+		reader->read (samples_per_frame / 2, samples_per_frame * 2, subset, &out_pointer);
+		for (int k = 0; k < samples_per_frame * 2; ++k) {
+			BOOST_REQUIRE_EQUAL (out[k], range_test_sample (samples_per_frame / 2 + k, 2) / float (1 << 23));
+		}
+
+		BOOST_CHECK_THROW (reader->read (reader->length() - 1, 2, subset, &out_pointer), dcp::DCPReadError);
+	}
+}
+
+/** Check that the different ways of giving samples to SoundAssetWriter give the same results */
+BOOST_AUTO_TEST_CASE (sound_asset_writer_formats_test)
+{
+	int const channels = 4;
+	/* Not a whole number of frames, so that the last one is padded */
+	int const samples = 4500;
+
+	vector<float> planar[channels];
+	float* planar_pointers[channels];
+	vector<float> interleaved_float;
+	vector<int32_t> interleaved_int;
+	vector<uint8_t> packed;
+
+	for (int i = 0; i < channels; ++i) {
+		planar[i].resize (samples);
+		planar_pointers[i] = &planar[i][0];
+	}
+
+	for (int i = 0; i < samples; ++i) {
+		for (int j = 0; j < channels; ++j) {
+			int32_t const s = range_test_sample (i, j);
+			planar[j][i] = s / float (1 << 23);
+			interleaved_float.push_back (planar[j][i]);
+			interleaved_int.push_back (s);
+			packed.push_back (s & 0xff);
+			packed.push_back ((s >> 8) & 0xff);
+			packed.push_back ((s >> 16) & 0xff);
+		}
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		boost::filesystem::path file = "build/test/sound_asset_writer_formats_test_" + dcp::raw_convert<std::string> (i) + ".mxf";
+		shared_ptr<dcp::SoundAsset> ms (new dcp::SoundAsset (dcp::Fraction (24, 1), 48000, channels, dcp::SMPTE));
+		shared_ptr<dcp::SoundAssetWriter> writer = ms->start_write (file);
+		/* Write in a few pieces which do not line up with frames */
+		for (int j = 0; j < samples; j += 1500) {
+			switch (i) {
+			case 0:
+			{
+				float* p[channels];
+				for (int k = 0; k < channels; ++k) {
+					p[k] = planar_pointers[k] + j;
+				}
+				writer->write (p, 1500);
+				break;
+			}
+			case 1:
+				writer->write_interleaved (&interleaved_float[j * channels], 1500);
+				break;
+			case 2:
+				writer->write_interleaved (&interleaved_int[j * channels], 1500);
+				break;
+			case 3:
+				writer->write_packed (&packed[j * channels * 3], 1500);
+				break;
+			}
+		}
+		writer->finalize ();
+	}
+
+	dcp::SoundAsset reference ("build/test/sound_asset_writer_formats_test_0.mxf");
+	BOOST_REQUIRE_EQUAL (reference.intrinsic_duration(), 3);
+
+	for (int i = 1; i < 4; ++i) {
+		dcp::SoundAsset check ("build/test/sound_asset_writer_formats_test_" + dcp::raw_convert<std::string> (i) + ".mxf");
+		BOOST_REQUIRE_EQUAL (check.intrinsic_duration(), reference.intrinsic_duration());
+		for (int j = 0; j < reference.intrinsic_duration(); ++j) {
+			shared_ptr<const dcp::SoundFrame> a = reference.start_read()->get_frame (j);
+			shared_ptr<const dcp::SoundFrame> b = check.start_read()->get_frame (j);
+			BOOST_REQUIRE_EQUAL (a->size(), b->size());
+			BOOST_CHECK (memcmp (a->data(), b->data(), a->size()) == 0);
+		}
+	}
+
+	/* The padding at the end of the last frame should be silent */
+	shared_ptr<const dcp::SoundFrame> last = reference.start_read()->get_frame (2);
+	for (int i = samples - 4000; i < 2000; ++i) {
+		for (int j = 0; j < channels; ++j) {
+			BOOST_REQUIRE_EQUAL (last->get (j, i), 0);
+		}
+	}
+}
@@ -34,10 +34,20 @@
 #include "verify.h"
 #include "util.h"
 #include "compose.hpp"
+#include "picture_asset.h"
+#include "picture_frame_checker.h"
+#include "verification_checkpoint.h"
+#include "file_identity.h"
+#include "file.h"
 #include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
 #include <cstdio>
+#include <fstream>
+#include <algorithm>
 #include <iostream>
+#include <set>
 
 using std::list;
 using std::pair;
@@ -202,3 +212,478 @@ BOOST_AUTO_TEST_CASE (verify_test5)
 	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::CPL_HASH_INCORRECT);
 	BOOST_CHECK_EQUAL (notes.back().code(), dcp::VerificationNote::INVALID_PICTURE_FRAME_RATE);
 }
+
+/* Corrupt the picture MXF and check that this is still spotted when reads drop the page cache */
+BOOST_AUTO_TEST_CASE (verify_test6)
+{
+	vector<boost::filesystem::path> directories = setup (6);
+
+	FILE* mod = fopen("build/test/verify_test6/video.mxf", "r+b");
+	BOOST_REQUIRE (mod);
+	fseek (mod, 4096, SEEK_SET);
+	int x = 42;
+	BOOST_REQUIRE (fwrite (&x, sizeof(x), 1, mod) == 1);
+	fclose (mod);
+
+	dcp::VerificationOptions options;
+	options.read_cache_mode = dcp::READ_CACHE_DROP;
+	list<dcp::VerificationNote> notes = dcp::verify (directories, &stage, &progress, options);
+
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_HASH_INCORRECT);
+}
+
+/* Corrupt the MXFs and check that this is spotted, in the same order, when hashing in parallel */
+BOOST_AUTO_TEST_CASE (verify_test7)
+{
+	vector<boost::filesystem::path> directories = setup (7);
+
+	int x = 42;
+	FILE* mod = fopen("build/test/verify_test7/video.mxf", "r+b");
+	BOOST_REQUIRE (mod);
+	fseek (mod, 4096, SEEK_SET);
+	BOOST_REQUIRE (fwrite (&x, sizeof(x), 1, mod) == 1);
+	fclose (mod);
+
+	mod = fopen("build/test/verify_test7/audio.mxf", "r+b");
+	BOOST_REQUIRE (mod);
+	fseek (mod, 4096, SEEK_SET);
+	BOOST_REQUIRE (fwrite (&x, sizeof(x), 1, mod) == 1);
+	fclose (mod);
+
+	dcp::VerificationOptions options;
+	options.jobs = 4;
+	options.jobs_per_device = 1;
+	list<dcp::VerificationNote> notes = dcp::verify (directories, &stage, &progress, options);
+
+	BOOST_REQUIRE_EQUAL (notes.size(), 2);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_HASH_INCORRECT);
+	BOOST_CHECK_EQUAL (notes.back().code(), dcp::VerificationNote::SOUND_HASH_INCORRECT);
+}
+
+static void
+count_frame (int64_t* frames, int64_t* duration, boost::shared_ptr<const dcp::PictureAsset> asset, int64_t index, uint8_t const *, int64_t size)
+{
+	BOOST_CHECK_EQUAL (index, *frames);
+	BOOST_CHECK (size > 0);
+	++(*frames);
+	*duration = asset->intrinsic_duration ();
+}
+
+/* Check that the frames of picture assets are given to a frame handler as they are hashed */
+BOOST_AUTO_TEST_CASE (verify_test8)
+{
+	for (int jobs = 1; jobs <= 2; ++jobs) {
+		vector<boost::filesystem::path> directories = setup (8);
+
+		int64_t frames = 0;
+		int64_t duration = 0;
+		dcp::VerificationOptions options;
+		options.jobs = jobs;
+		options.picture_frame_handler = boost::bind (&count_frame, &frames, &duration, _1, _2, _3, _4);
+		list<dcp::VerificationNote> notes = dcp::verify (directories, &stage, &progress, options);
+
+		BOOST_CHECK_EQUAL (notes.size(), 0);
+		BOOST_CHECK (frames > 0);
+		BOOST_CHECK_EQUAL (frames, duration);
+	}
+}
+
+/** @return A KLV packet containing some data */
+static vector<uint8_t>
+klv (vector<uint8_t> const & value)
+{
+	vector<uint8_t> packet (16, 0x06);
+	packet.push_back (0x83);
+	packet.push_back ((value.size() >> 16) & 0xff);
+	packet.push_back ((value.size() >> 8) & 0xff);
+	packet.push_back (value.size() & 0xff);
+	packet.insert (packet.end(), value.begin(), value.end());
+	return packet;
+}
+
+/** @return The codestream of test/data/32x32_red_square.j2c, marked as using the DCI 2K profile */
+static vector<uint8_t>
+dci_codestream ()
+{
+	dcp::File j2c ("test/data/32x32_red_square.j2c");
+	vector<uint8_t> codestream (j2c.data(), j2c.data() + j2c.size());
+	/* Rsiz */
+	codestream[6] = 0;
+	codestream[7] = 3;
+	return codestream;
+}
+
+/** @return Offset of the COD marker in a codestream */
+static size_t
+cod (vector<uint8_t> const & codestream)
+{
+	uint8_t const marker[] = { 0xff, 0x52 };
+	return std::search (codestream.begin(), codestream.end(), marker, marker + 2) - codestream.begin();
+}
+
+static list<dcp::VerificationNote>
+check_frames (vector<uint8_t> const & frame, bool stereo)
+{
+	dcp::PictureFrameChecker checker ("foo.mxf", dcp::Fraction (24, 1), stereo, false);
+	checker.check (0, &frame[0], frame.size());
+	checker.check (1, &frame[0], frame.size());
+	return checker.notes ();
+}
+
+/* Check the checks made on the size and codestream header of picture frames */
+BOOST_AUTO_TEST_CASE (verify_picture_frame_checker_test)
+{
+	vector<uint8_t> const good = dci_codestream ();
+	BOOST_CHECK (check_frames (klv (good), false).empty ());
+
+	vector<uint8_t> both = klv (good);
+	vector<uint8_t> const right = klv (good);
+	both.insert (both.end(), right.begin(), right.end());
+	BOOST_CHECK (check_frames (both, true).empty ());
+
+	/* Not DCI profile */
+	vector<uint8_t> bad = good;
+	bad[7] = 0;
+	list<dcp::VerificationNote> notes = check_frames (klv (bad), false);
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::INVALID_JPEG2000_PROFILE);
+	BOOST_CHECK_EQUAL (notes.front().note().get(), "2 frame(s), the first being frame 0");
+	BOOST_CHECK_EQUAL (notes.front().file().get(), "foo.mxf");
+
+	/* LRCP progression order */
+	bad = good;
+	bad[cod(bad) + 5] = 0;
+	notes = check_frames (klv (bad), false);
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::INVALID_JPEG2000_PROGRESSION_ORDER);
+
+	/* Too many decomposition levels for 2K */
+	bad = good;
+	bad[cod(bad) + 9] = 6;
+	notes = check_frames (klv (bad), false);
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::INVALID_JPEG2000_RESOLUTION_LEVELS);
+
+	/* Not a codestream at all */
+	notes = check_frames (klv (vector<uint8_t> (64, 0)), false);
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::INVALID_JPEG2000_CODESTREAM);
+
+	/* 700000 bytes per frame is within 250Mbit/s at 24fps for 2D but not for each eye of 3D */
+	vector<uint8_t> big = good;
+	big.resize (700000);
+	BOOST_CHECK (check_frames (klv (big), false).empty ());
+	vector<uint8_t> const eye = klv (big);
+	both = eye;
+	both.insert (both.end(), eye.begin(), eye.end());
+	notes = check_frames (both, true);
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_FRAME_TOO_LARGE);
+
+	big.resize (1400000);
+	notes = check_frames (klv (big), false);
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_FRAME_TOO_LARGE);
+}
+
+/** @return The value of an encrypted triplet (SMPTE 429-6) with some plaintext size and some
+ *  made-up ciphertext.
+ */
+static vector<uint8_t>
+triplet (int64_t source_length, size_t ciphertext)
+{
+	vector<vector<uint8_t> > items;
+	/* ContextID, PlaintextOffset, SourceKey */
+	items.push_back (vector<uint8_t> (16, 0x42));
+	items.push_back (vector<uint8_t> (8, 0));
+	items.push_back (vector<uint8_t> (16, 0x06));
+	/* SourceLength */
+	vector<uint8_t> length;
+	for (int i = 7; i >= 0; --i) {
+		length.push_back ((source_length >> (i * 8)) & 0xff);
+	}
+	items.push_back (length);
+	/* EncryptedSourceValue */
+	items.push_back (vector<uint8_t> (ciphertext, 0x99));
+
+	vector<uint8_t> value;
+	BOOST_FOREACH (vector<uint8_t> const & i, items) {
+		/* Items have a length but no key */
+		vector<uint8_t> const packet = klv (i);
+		value.insert (value.end(), packet.begin() + 16, packet.end());
+	}
+	return value;
+}
+
+/* Check that the size limit applies to the plaintext of frames of an encrypted asset */
+BOOST_AUTO_TEST_CASE (verify_picture_frame_checker_encrypted_test)
+{
+	/* 1302083 bytes per frame is 250Mbit/s at 24fps; this frame is just within it, but its
+	   ciphertext (padded, with the IV and check value) is not.
+	*/
+	vector<uint8_t> frame = klv (triplet (1302080, 1302080 + 16 + 32));
+	dcp::PictureFrameChecker good ("foo.mxf", dcp::Fraction (24, 1), false, true);
+	good.check (0, &frame[0], frame.size());
+	BOOST_CHECK (good.notes().empty ());
+
+	frame = klv (triplet (1302090, 1302090 + 6 + 32));
+	dcp::PictureFrameChecker big ("foo.mxf", dcp::Fraction (24, 1), false, true);
+	big.check (0, &frame[0], frame.size());
+	list<dcp::VerificationNote> notes = big.notes ();
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_FRAME_TOO_LARGE);
+
+	/* Not a triplet */
+	frame = klv (vector<uint8_t> (64, 0xff));
+	dcp::PictureFrameChecker bad ("foo.mxf", dcp::Fraction (24, 1), false, true);
+	bad.check (0, &frame[0], frame.size());
+	notes = bad.notes ();
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::INVALID_JPEG2000_CODESTREAM);
+}
+
+/* Check the choice of frames made by PictureFrameSampler, and the notes it gives */
+BOOST_AUTO_TEST_CASE (verify_picture_frame_sampler_test)
+{
+	std::set<int64_t> boundaries;
+	boundaries.insert (41);
+	boundaries.insert (500);
+
+	dcp::PictureFrameSampler a ("foo.mxf", "bar", 100, false, 0.1, boundaries, 42);
+	dcp::PictureFrameSampler b ("foo.mxf", "bar", 100, false, 0.1, boundaries, 42);
+	/* The same sample every time */
+	BOOST_CHECK (a.sample() == b.sample());
+	/* One from each of 10 strata, plus the ends and the boundary within the asset */
+	BOOST_CHECK (a.sample().size() >= 10);
+	BOOST_CHECK (a.sample().size() <= 13);
+	BOOST_CHECK (a.sample().find(0) != a.sample().end());
+	BOOST_CHECK (a.sample().find(41) != a.sample().end());
+	BOOST_CHECK (a.sample().find(99) != a.sample().end());
+	BOOST_CHECK (a.sample().find(500) == a.sample().end());
+	for (int i = 0; i < 10; ++i) {
+		BOOST_CHECK (a.sample().lower_bound(i * 10) != a.sample().lower_bound((i + 1) * 10));
+	}
+
+	dcp::PictureFrameSampler all ("foo.mxf", "bar", 100, false, 1, std::set<int64_t> (), 42);
+	BOOST_CHECK_EQUAL (all.sample().size(), 100);
+
+	vector<uint8_t> const good = klv (dci_codestream ());
+	vector<uint8_t> const bad = klv (vector<uint8_t> (64, 0));
+
+	dcp::PictureFrameSampler sampler ("foo.mxf", "bar", 100, false, 0.1, boundaries, 42);
+	for (int i = 0; i < 100; ++i) {
+		sampler.check (i, &good[0], good.size());
+	}
+	list<dcp::VerificationNote> notes = sampler.notes ();
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().type(), dcp::VerificationNote::VERIFY_INFO);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_FRAMES_SAMPLED);
+	BOOST_CHECK_EQUAL (notes.front().file().get(), "foo.mxf");
+
+	dcp::PictureFrameSampler broken ("foo.mxf", "bar", 100, false, 0.1, boundaries, 42);
+	for (int i = 0; i < 100; ++i) {
+		broken.check (i, i == 41 ? &bad[0] : &good[0], i == 41 ? bad.size() : good.size());
+	}
+	notes = broken.notes ();
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().type(), dcp::VerificationNote::VERIFY_ERROR);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_FRAME_DECODE_FAILED);
+	BOOST_CHECK_EQUAL (notes.front().note().get(), dcp::String::compose ("1 of %1 sampled frame(s), the first being frame 41", broken.sample().size()));
+
+	/* Sampled frames which never arrive are errors too, and leave no claim of confidence */
+	dcp::PictureFrameSampler short_file ("foo.mxf", "bar", 100, false, 0.1, boundaries, 42);
+	for (int i = 0; i < 50; ++i) {
+		short_file.check (i, &good[0], good.size());
+	}
+	short_file.not_reached (50);
+	notes = short_file.notes ();
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().type(), dcp::VerificationNote::VERIFY_ERROR);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_FRAME_DECODE_FAILED);
+	BOOST_CHECK_EQUAL (
+		notes.front().note().get(),
+		dcp::String::compose (
+			"%1 sampled frame(s) could not be found in the file, the first being frame %2",
+			std::distance (short_file.sample().lower_bound(50), short_file.sample().end()),
+			*short_file.sample().lower_bound(50)
+			)
+		);
+}
+
+/* Check that sampling the frames of a good DCP gives just a note of what was sampled */
+BOOST_AUTO_TEST_CASE (verify_test9)
+{
+	vector<boost::filesystem::path> directories = setup (9);
+
+	dcp::VerificationOptions options;
+	options.sample_fraction = 0.1;
+	options.sample_seed = 1;
+	list<dcp::VerificationNote> notes = dcp::verify (directories, &stage, &progress, options);
+
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().type(), dcp::VerificationNote::VERIFY_INFO);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_FRAMES_SAMPLED);
+}
+
+/* Check that assets recorded in a checkpoint are not read again unless they change */
+BOOST_AUTO_TEST_CASE (verify_checkpoint_test)
+{
+	vector<boost::filesystem::path> directories = setup (10);
+	boost::filesystem::path const checkpoint = "build/test/verify_test10.checkpoint";
+	boost::filesystem::remove (checkpoint);
+
+	dcp::VerificationOptions options;
+	options.checkpoint = checkpoint;
+	options.check_picture_frames = true;
+	BOOST_CHECK_EQUAL (dcp::verify (directories, &stage, &progress, options).size(), 0);
+
+	boost::filesystem::path const audio = "build/test/verify_test10/audio.mxf";
+	{
+		dcp::VerificationCheckpoint c (checkpoint);
+		string hash;
+		list<dcp::VerificationNote> notes;
+		BOOST_CHECK (c.find (dcp::FileIdentity (audio), "hash", audio, &hash, &notes));
+		BOOST_CHECK (!hash.empty ());
+		BOOST_CHECK (notes.empty ());
+		BOOST_CHECK (!c.find (dcp::FileIdentity (audio), "other", audio, &hash, &notes));
+
+		/* Notes survive a round trip */
+		notes.push_back (dcp::VerificationNote (dcp::VerificationNote::VERIFY_ERROR, dcp::VerificationNote::PICTURE_FRAME_TOO_LARGE, "1 frame(s)", audio));
+		c.add (dcp::FileIdentity (audio), "other", hash, notes);
+	}
+
+	/* A partly-written entry is ignored */
+	FILE* f = fopen (checkpoint.string().c_str(), "a");
+	BOOST_REQUIRE (f);
+	fprintf (f, "asset 1 2");
+	fclose (f);
+
+	{
+		dcp::VerificationCheckpoint c (checkpoint);
+		string hash;
+		list<dcp::VerificationNote> notes;
+		BOOST_CHECK (c.find (dcp::FileIdentity (audio), "other", "foo.mxf", &hash, &notes));
+		BOOST_REQUIRE_EQUAL (notes.size(), 1);
+		BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_FRAME_TOO_LARGE);
+		BOOST_CHECK_EQUAL (notes.front().note().get(), "1 frame(s)");
+		BOOST_CHECK_EQUAL (notes.front().file().get(), "foo.mxf");
+
+		/* Pretend that audio.mxf was found to have a different hash */
+		c.add (dcp::FileIdentity (audio), "hash", "a1b2c3", list<dcp::VerificationNote> ());
+	}
+
+	/* audio.mxf is not read again, so the wrong hash is used */
+	list<dcp::VerificationNote> notes = dcp::verify (directories, &stage, &progress, options);
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::SOUND_HASH_INCORRECT);
+
+#ifdef LIBDCP_POSIX
+	/* Once audio.mxf has been rewritten it is read again, even though its size and
+	   modification time (to the second) are the same.
+	*/
+	std::time_t const modification_time = boost::filesystem::last_write_time (audio);
+	vector<uint8_t> data (boost::filesystem::file_size (audio));
+	f = fopen (audio.string().c_str(), "r+b");
+	BOOST_REQUIRE (f);
+	BOOST_REQUIRE_EQUAL (fread (&data[0], 1, data.size(), f), data.size());
+	rewind (f);
+	BOOST_REQUIRE_EQUAL (fwrite (&data[0], 1, data.size(), f), data.size());
+	fclose (f);
+	boost::filesystem::last_write_time (audio, modification_time);
+	BOOST_CHECK_EQUAL (dcp::verify (directories, &stage, &progress, options).size(), 0);
+#endif
+
+	/* The same goes for a change to the modification time alone */
+	{
+		dcp::VerificationCheckpoint c (checkpoint);
+		c.add (dcp::FileIdentity (audio), "hash", "a1b2c3", list<dcp::VerificationNote> ());
+	}
+	boost::filesystem::last_write_time (audio, boost::filesystem::last_write_time (audio) + 10);
+	BOOST_CHECK_EQUAL (dcp::verify (directories, &stage, &progress, options).size(), 0);
+}
+
+/** @return The checks in the last entry for file in checkpoint */
+static string
+checkpoint_checks (boost::filesystem::path checkpoint, boost::filesystem::path file)
+{
+	std::ifstream in (checkpoint.string().c_str());
+	string line;
+	string checks;
+	while (std::getline (in, line)) {
+		if (boost::algorithm::starts_with (line, "asset ") && boost::algorithm::ends_with (line, " " + boost::filesystem::canonical(file).string())) {
+			vector<string> fields;
+			boost::algorithm::split (fields, line, boost::is_any_of (" "));
+			BOOST_REQUIRE (fields.size() >= 10);
+			checks = fields[9];
+		}
+	}
+	return checks;
+}
+
+/* Check that an asset's entry in a checkpoint is not used when the reel boundaries that it was sampled with change */
+BOOST_AUTO_TEST_CASE (verify_checkpoint_boundaries_test)
+{
+	vector<boost::filesystem::path> directories = setup (12);
+	boost::filesystem::path const checkpoint = "build/test/verify_test12.checkpoint";
+	boost::filesystem::remove (checkpoint);
+
+	dcp::VerificationOptions options;
+	options.checkpoint = checkpoint;
+	options.sample_fraction = 0.1;
+	options.sample_seed = 1;
+	BOOST_CHECK_EQUAL (dcp::verify (directories, &stage, &progress, options).size(), 1);
+
+	boost::filesystem::path const video = "build/test/verify_test12/video.mxf";
+	string const checks = checkpoint_checks (checkpoint, video);
+	BOOST_CHECK (boost::algorithm::ends_with (checks, ",boundaries=0:23"));
+
+	/* Pretend that video.mxf was found to have a different hash */
+	{
+		dcp::VerificationCheckpoint c (checkpoint);
+		c.add (dcp::FileIdentity (video), checks, "a1b2c3", list<dcp::VerificationNote> ());
+	}
+
+	/* With the same CPL the entry is used */
+	list<dcp::VerificationNote> notes = dcp::verify (directories, &stage, &progress, options);
+	BOOST_REQUIRE_EQUAL (notes.size(), 1);
+	BOOST_CHECK_EQUAL (notes.front().code(), dcp::VerificationNote::PICTURE_HASH_INCORRECT);
+
+	/* Shorten the reels, which moves the last boundary */
+	boost::filesystem::path const cpl_file = "build/test/verify_test12/cpl_81fb54df-e1bf-4647-8788-ea7ba154375b.xml";
+	string cpl = dcp::file_to_string (cpl_file);
+	boost::algorithm::replace_all (cpl, "<Duration>24</Duration>", "<Duration>12</Duration>");
+	FILE* f = fopen (cpl_file.string().c_str(), "w");
+	BOOST_REQUIRE (f);
+	fwrite (cpl.c_str(), cpl.length(), 1, f);
+	fclose (f);
+
+	/* Now video.mxf is read again, so its hash is correct */
+	notes = dcp::verify (directories, &stage, &progress, options);
+	BOOST_FOREACH (dcp::VerificationNote i, notes) {
+		BOOST_CHECK (i.code() != dcp::VerificationNote::PICTURE_HASH_INCORRECT);
+	}
+	BOOST_CHECK (boost::algorithm::ends_with (checkpoint_checks (checkpoint, video), ",boundaries=0:11"));
+}
+
+/* Check that a checkpoint from an older version of libdcp is not used, but does not stop verification */
+BOOST_AUTO_TEST_CASE (verify_old_checkpoint_test)
+{
+	vector<boost::filesystem::path> directories = setup (11);
+	boost::filesystem::path const checkpoint = "build/test/verify_test11.checkpoint";
+
+	FILE* f = fopen (checkpoint.string().c_str(), "w");
+	BOOST_REQUIRE (f);
+	fprintf (f, "libdcp-verification-checkpoint-1\nasset 1 2 3 4 a1b2c3 hash 0 audio.mxf\n");
+	fclose (f);
+
+	dcp::VerificationOptions options;
+	options.checkpoint = checkpoint;
+	BOOST_CHECK_EQUAL (dcp::verify (directories, &stage, &progress, options).size(), 0);
+
+	/* The checkpoint has been replaced with a current one */
+	std::ifstream in (checkpoint.string().c_str());
+	string line;
+	std::getline (in, line);
+	BOOST_CHECK_EQUAL (line, "libdcp-verification-checkpoint-2");
+}
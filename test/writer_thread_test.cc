@@ -0,0 +1,70 @@
+/*
+    Copyright (C) 2019 Carl Hetherington <cth@carlh.net>
+
+    This file is part of libdcp.
+
+    libdcp is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    libdcp is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libdcp.  If not, see <http://www.gnu.org/licenses/>.
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of portions of this program with the
+    OpenSSL library under certain conditions as described in each
+    individual source file, and distribute linked combinations
+    including the two.
+
+    You must obey the GNU General Public License in all respects
+    for all of the code used other than OpenSSL.  If you modify
+    file(s) with this exception, you may extend this exception to your
+    version of the file(s), but you are not obligated to do so.  If you
+    do not wish to do so, delete this exception statement from your
+    version.  If you delete this exception statement from all source
+    files in the program, then also delete it here.
+*/
+
+#include "writer_thread.h"
+#include "exceptions.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+
+static void
+fail ()
+{
+	boost::throw_exception (dcp::MiscError ("failed"));
+}
+
+static void
+count (int* n)
+{
+	++(*n);
+}
+
+/** Check that once a job has failed, nothing else is run and every later call throws */
+BOOST_AUTO_TEST_CASE (writer_thread_error_test)
+{
+	dcp::WriterThread thread (4);
+	int n = 0;
+	thread.add (boost::bind (&count, &n));
+	thread.add (&fail);
+	try {
+		/* This may throw, if the failure has already happened, or it may be discarded */
+		thread.add (boost::bind (&count, &n));
+	} catch (dcp::MiscError &) {
+
+	}
+	BOOST_CHECK_THROW (thread.drain (), dcp::MiscError);
+	BOOST_CHECK_EQUAL (n, 1);
+
+	BOOST_CHECK_THROW (thread.add (boost::bind (&count, &n)), dcp::MiscError);
+	BOOST_CHECK_THROW (thread.drain (), dcp::MiscError);
+	BOOST_CHECK_EQUAL (n, 1);
+}
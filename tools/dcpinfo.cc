@@ -60,6 +60,7 @@ using std::string;
 using std::cerr;
 using std::cout;
 using std::list;
+using std::vector;
 using std::pair;
 using std::min;
 using std::max;
@@ -83,7 +84,7 @@ help (string n)
 }
 
 static double
-mbits_per_second (int size, Fraction frame_rate)
+mbits_per_second (int64_t size, Fraction frame_rate)
 {
 	return size * 8 * frame_rate.as_float() / 1e6;
 }
@@ -116,7 +117,26 @@ main_picture (shared_ptr<Reel> reel, bool analyse, bool decompress)
 		}
 
 		shared_ptr<MonoPictureAsset> ma = dynamic_pointer_cast<MonoPictureAsset>(reel->main_picture()->asset());
-		if (analyse && ma) {
+		if (analyse && ma && !decompress) {
+			/* We can get the frame sizes from the MXF index without reading any essence.  These are the
+			   sizes of the frames' KLV packets, so they are a little bigger than the J2K codestreams; for
+			   encrypted assets they also include the encryption overhead (IV, check value, padding and
+			   integrity pack).
+			*/
+			vector<FrameIndexEntry> index = ma->frame_index ();
+			pair<int64_t, int64_t> size_range (INT64_MAX, 0);
+			for (int64_t i = 0; i < static_cast<int64_t>(index.size()); ++i) {
+				printf("Frame %" PRId64 " KLV size %7" PRId64 "\n", i, index[i].size);
+				size_range.first = min(size_range.first, index[i].size);
+				size_range.second = max(size_range.second, index[i].size);
+			}
+			printf(
+				"KLV size ranges from %" PRId64 " (%.1f Mbit/s) to %" PRId64 " (%.1f Mbit/s)%s\n",
+				size_range.first, mbits_per_second(size_range.first, ma->frame_rate()),
+				size_range.second, mbits_per_second(size_range.second, ma->frame_rate()),
+				ma->encrypted() ? ", including encryption overhead" : ""
+				);
+		} else if (analyse && ma) {
 			shared_ptr<MonoPictureAssetReader> reader = ma->start_read ();
 			pair<int, int> j2k_size_range (INT_MAX, 0);
 			for (int64_t i = 0; i < ma->intrinsic_duration(); ++i) {
@@ -32,6 +32,7 @@
 */
 
 #include "verify.h"
+#include "rate_limiter.h"
 #include "compose.hpp"
 #include <boost/bind.hpp>
 #include <boost/optional.hpp>
@@ -53,8 +54,16 @@ static void
 help (string n)
 {
 	cerr << "Syntax: " << n << " [OPTION] <DCP>\n"
-	     << "  -V, --version   show libdcp version\n"
-	     << "  -h, --help      show this help\n";
+	     << "  -V, --version               show libdcp version\n"
+	     << "  -h, --help                  show this help\n"
+	     << "      --drop-cache            drop the DCP's data from the page cache once it has been read\n"
+	     << "  -r, --rate <MB/s>           limit the rate at which the DCP is read\n"
+	     << "  -j, --jobs <n>              hash up to n assets at the same time\n"
+	     << "      --jobs-per-device <n>   hash up to n assets on any one storage device at the same time\n"
+	     << "      --check-frames          check the size and JPEG2000 header of every picture frame\n"
+	     << "      --sample <fraction>     decode a sample of this fraction (from 0 to 1) of each picture asset's frames\n"
+	     << "      --seed <n>              seed for choosing the frames to sample\n"
+	     << "      --checkpoint <file>     record checked assets in file, and skip those it says are already checked\n";
 }
 
 void
@@ -91,6 +100,20 @@ note_to_string (dcp::VerificationNote note)
 		return dcp::String::compose("The hash of the sound asset %1 does not agree with the PKL file", note.file()->filename());
 	case dcp::VerificationNote::PKL_CPL_SOUND_HASHES_DISAGREE:
 		return "The PKL and CPL hashes disagree for a sound asset.";
+	case dcp::VerificationNote::PICTURE_FRAME_TOO_LARGE:
+		return dcp::String::compose("Frames of the picture asset %1 exceed the maximum bit rate: %2", note.file()->filename(), *note.note());
+	case dcp::VerificationNote::INVALID_JPEG2000_CODESTREAM:
+		return dcp::String::compose("Frames of the picture asset %1 have invalid JPEG2000 codestreams: %2", note.file()->filename(), *note.note());
+	case dcp::VerificationNote::INVALID_JPEG2000_PROFILE:
+		return dcp::String::compose("Frames of the picture asset %1 do not use the DCI JPEG2000 profiles: %2", note.file()->filename(), *note.note());
+	case dcp::VerificationNote::INVALID_JPEG2000_RESOLUTION_LEVELS:
+		return dcp::String::compose("Frames of the picture asset %1 have the wrong number of resolution levels: %2", note.file()->filename(), *note.note());
+	case dcp::VerificationNote::INVALID_JPEG2000_PROGRESSION_ORDER:
+		return dcp::String::compose("Frames of the picture asset %1 do not use CPRL progression order: %2", note.file()->filename(), *note.note());
+	case dcp::VerificationNote::PICTURE_FRAME_DECODE_FAILED:
+		return dcp::String::compose("Frames of the picture asset %1 could not be decoded: %2", note.file()->filename(), *note.note());
+	case dcp::VerificationNote::PICTURE_FRAMES_SAMPLED:
+		return dcp::String::compose("Sampled frames of the picture asset %1: %2", note.file()->filename(), *note.note());
 	}
 
 	return "";
@@ -99,15 +122,26 @@ note_to_string (dcp::VerificationNote note)
 int
 main (int argc, char* argv[])
 {
+	dcp::VerificationOptions options;
+	options.read_cache_mode = dcp::READ_CACHE_KEEP;
+
 	int option_index = 0;
 	while (true) {
 		static struct option long_options[] = {
 			{ "version", no_argument, 0, 'V'},
 			{ "help", no_argument, 0, 'h'},
+			{ "drop-cache", no_argument, 0, 'A'},
+			{ "rate", required_argument, 0, 'r'},
+			{ "jobs", required_argument, 0, 'j'},
+			{ "jobs-per-device", required_argument, 0, 'B'},
+			{ "check-frames", no_argument, 0, 'C'},
+			{ "sample", required_argument, 0, 'D'},
+			{ "seed", required_argument, 0, 'E'},
+			{ "checkpoint", required_argument, 0, 'F'},
 			{ 0, 0, 0, 0 }
 		};
 
-		int c = getopt_long (argc, argv, "Vh", long_options, &option_index);
+		int c = getopt_long (argc, argv, "Vhr:j:", long_options, &option_index);
 
 		if (c == -1) {
 			break;
@@ -120,6 +154,30 @@ main (int argc, char* argv[])
 		case 'h':
 			help (argv[0]);
 			exit (EXIT_SUCCESS);
+		case 'A':
+			options.read_cache_mode = dcp::READ_CACHE_DROP;
+			break;
+		case 'r':
+			options.rate_limiter.reset (new dcp::RateLimiter (atof (optarg) * 1000000));
+			break;
+		case 'j':
+			options.jobs = atoi (optarg);
+			break;
+		case 'B':
+			options.jobs_per_device = atoi (optarg);
+			break;
+		case 'C':
+			options.check_picture_frames = true;
+			break;
+		case 'D':
+			options.sample_fraction = atof (optarg);
+			break;
+		case 'E':
+			options.sample_seed = strtoul (optarg, 0, 10);
+			break;
+		case 'F':
+			options.checkpoint = boost::filesystem::path (optarg);
+			break;
 		}
 	}
 
@@ -135,7 +193,7 @@ main (int argc, char* argv[])
 
 	vector<boost::filesystem::path> directories;
 	directories.push_back (argv[optind]);
-	list<dcp::VerificationNote> notes = dcp::verify (directories, bind(&stage, _1, _2), bind(&progress));
+	list<dcp::VerificationNote> notes = dcp::verify (directories, bind(&stage, _1, _2), bind(&progress), options);
 
 	bool failed = false;
 	BOOST_FOREACH (dcp::VerificationNote i, notes) {
@@ -147,6 +205,9 @@ main (int argc, char* argv[])
 		case dcp::VerificationNote::VERIFY_WARNING:
 			cout << "Warning: " << note_to_string(i) << "\n";
 			break;
+		case dcp::VerificationNote::VERIFY_INFO:
+			cout << "Note: " << note_to_string(i) << "\n";
+			break;
 		}
 	}
 